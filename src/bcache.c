@@ -0,0 +1,368 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "header/stdlib/string.h"
+#include "header/filesystem/bcache.h"
+#include "header/driver/iostat.h"
+
+static struct BufferCacheState bcache_state = {0};
+
+static struct ClusterBuffer bcache_prefetch_buffer[BCACHE_PREFETCH_MAX];
+
+static uint32_t bcache_hash(uint32_t cluster_number)
+{
+    return cluster_number % BCACHE_HASH_SIZE;
+}
+
+/* -- LRU list -- */
+
+static void bcache_lru_unlink(int16_t index)
+{
+    struct BufferCacheEntry *entry = &bcache_state.entry[index];
+    if (entry->lru_prev != BCACHE_NO_ENTRY)
+        bcache_state.entry[entry->lru_prev].lru_next = entry->lru_next;
+    else
+        bcache_state.lru_head = entry->lru_next;
+
+    if (entry->lru_next != BCACHE_NO_ENTRY)
+        bcache_state.entry[entry->lru_next].lru_prev = entry->lru_prev;
+    else
+        bcache_state.lru_tail = entry->lru_prev;
+}
+
+static void bcache_lru_push_back(int16_t index)
+{
+    struct BufferCacheEntry *entry = &bcache_state.entry[index];
+    entry->lru_prev = bcache_state.lru_tail;
+    entry->lru_next = BCACHE_NO_ENTRY;
+    if (bcache_state.lru_tail != BCACHE_NO_ENTRY)
+        bcache_state.entry[bcache_state.lru_tail].lru_next = index;
+    else
+        bcache_state.lru_head = index;
+    bcache_state.lru_tail = index;
+}
+
+static void bcache_lru_push_front(int16_t index)
+{
+    struct BufferCacheEntry *entry = &bcache_state.entry[index];
+    entry->lru_prev = BCACHE_NO_ENTRY;
+    entry->lru_next = bcache_state.lru_head;
+    if (bcache_state.lru_head != BCACHE_NO_ENTRY)
+        bcache_state.entry[bcache_state.lru_head].lru_prev = index;
+    else
+        bcache_state.lru_tail = index;
+    bcache_state.lru_head = index;
+}
+
+/* -- Hash table -- */
+
+static int16_t bcache_lookup(uint32_t cluster_number)
+{
+    int16_t index = bcache_state.hash_head[bcache_hash(cluster_number)];
+    while (index != BCACHE_NO_ENTRY && bcache_state.entry[index].cluster_number != cluster_number)
+        index = bcache_state.entry[index].hash_next;
+    return index;
+}
+
+static void bcache_hash_remove(int16_t index)
+{
+    int16_t *link = &bcache_state.hash_head[bcache_hash(bcache_state.entry[index].cluster_number)];
+    while (*link != index)
+        link = &bcache_state.entry[*link].hash_next;
+    *link = bcache_state.entry[index].hash_next;
+}
+
+/* -- Entry management -- */
+
+// Entry buffer is reused right after this, so dirty content is dispatched even inside plugged section
+static void bcache_write_back(int16_t index)
+{
+    struct BufferCacheEntry *entry = &bcache_state.entry[index];
+    write_blocks(&entry->data, cluster_to_lba(entry->cluster_number), CLUSTER_BLOCK_COUNT);
+    disk_dispatch();
+    entry->dirty = false;
+    bcache_state.statistics.write_back++;
+}
+
+// Take least recently used entry, evicting its cluster, and make it most recently used
+static int16_t bcache_allocate(uint32_t cluster_number)
+{
+    int16_t index                  = bcache_state.lru_tail;
+    struct BufferCacheEntry *entry = &bcache_state.entry[index];
+    if (entry->valid)
+    {
+        if (entry->dirty)
+            bcache_write_back(index);
+        bcache_hash_remove(index);
+        bcache_state.statistics.eviction++;
+    }
+
+    uint32_t bucket      = bcache_hash(cluster_number);
+    entry->cluster_number = cluster_number;
+    entry->valid          = true;
+    entry->dirty          = false;
+    entry->prefetched     = false;
+    entry->hash_next      = bcache_state.hash_head[bucket];
+    bcache_state.hash_head[bucket] = index;
+
+    bcache_lru_unlink(index);
+    bcache_lru_push_front(index);
+    return index;
+}
+
+static void bcache_touch(int16_t index)
+{
+    if (bcache_state.lru_head != index)
+    {
+        bcache_lru_unlink(index);
+        bcache_lru_push_front(index);
+    }
+}
+
+static void bcache_reset(uint16_t capacity)
+{
+    for (uint16_t i = 0; i < BCACHE_HASH_SIZE; i++)
+        bcache_state.hash_head[i] = BCACHE_NO_ENTRY;
+
+    bcache_state.capacity = capacity;
+    bcache_state.lru_head = BCACHE_NO_ENTRY;
+    bcache_state.lru_tail = BCACHE_NO_ENTRY;
+    for (int16_t i = 0; i < capacity; i++)
+    {
+        bcache_state.entry[i].valid     = false;
+        bcache_state.entry[i].dirty     = false;
+        bcache_state.entry[i].hash_next = BCACHE_NO_ENTRY;
+        bcache_lru_push_front(i);
+    }
+}
+
+/* -- Buffer cache interfaces -- */
+
+void initialize_buffer_cache(void)
+{
+    memset(&bcache_state.statistics, 0, sizeof(struct BufferCacheStatistics));
+    bcache_state.policy = BCACHE_WRITE_THROUGH;
+    bcache_state.epoch  = 0;
+    bcache_reset(BCACHE_CAPACITY);
+}
+
+void bcache_configure(uint16_t capacity, enum BufferCachePolicy policy)
+{
+    if (capacity < 1)
+        capacity = 1;
+    if (capacity > BCACHE_CAPACITY)
+        capacity = BCACHE_CAPACITY;
+
+    bcache_flush();
+    bcache_state.policy = policy;
+    bcache_reset(capacity);
+}
+
+enum BufferCachePolicy bcache_get_policy(void)
+{
+    return bcache_state.policy;
+}
+
+void bcache_read(void *ptr, uint32_t cluster_number, uint32_t cluster_count)
+{
+    bool fill   = cluster_count <= BCACHE_FILL_LIMIT;
+    uint32_t i  = 0;
+    while (i < cluster_count)
+    {
+        uint8_t *buf  = (uint8_t *)ptr + i * CLUSTER_SIZE;
+        int16_t index = bcache_lookup(cluster_number + i);
+        if (index != BCACHE_NO_ENTRY)
+        {
+            memcpy(buf, &bcache_state.entry[index].data, CLUSTER_SIZE);
+            bcache_touch(index);
+            bcache_state.statistics.hit++;
+            iostat_record_cache_hit(1);
+            if (bcache_state.entry[index].prefetched)
+            {
+                bcache_state.entry[index].prefetched = false;
+                bcache_state.statistics.prefetch_hit++;
+            }
+            i++;
+            continue;
+        }
+
+        // Missing cluster cannot be dirty, read whole missing run directly into caller buffer
+        uint32_t run = 1;
+        while (i + run < cluster_count && bcache_lookup(cluster_number + i + run) == BCACHE_NO_ENTRY)
+            run++;
+        read_blocks(buf, cluster_to_lba(cluster_number + i), run * CLUSTER_BLOCK_COUNT);
+        bcache_state.statistics.miss += run;
+
+        if (fill)
+        {
+            for (uint32_t j = 0; j < run; j++)
+            {
+                index = bcache_allocate(cluster_number + i + j);
+                memcpy(&bcache_state.entry[index].data, buf + j * CLUSTER_SIZE, CLUSTER_SIZE);
+            }
+        }
+        i += run;
+    }
+}
+
+bool bcache_contains(uint32_t cluster_number)
+{
+    return bcache_lookup(cluster_number) != BCACHE_NO_ENTRY;
+}
+
+void bcache_prefetch(uint32_t cluster_number, uint32_t cluster_count)
+{
+    if (cluster_count > BCACHE_PREFETCH_MAX)
+        cluster_count = BCACHE_PREFETCH_MAX;
+
+    int16_t filled[BCACHE_PREFETCH_MAX];
+    uint32_t filled_count = 0;
+    uint32_t i = 0;
+    while (i < cluster_count)
+    {
+        if (bcache_lookup(cluster_number + i) != BCACHE_NO_ENTRY)
+        {
+            i++;
+            continue;
+        }
+
+        uint32_t run = 1;
+        while (i + run < cluster_count && bcache_lookup(cluster_number + i + run) == BCACHE_NO_ENTRY)
+            run++;
+        read_blocks(bcache_prefetch_buffer, cluster_to_lba(cluster_number + i), run * CLUSTER_BLOCK_COUNT);
+        bcache_state.statistics.prefetch += run;
+
+        for (uint32_t j = 0; j < run; j++)
+        {
+            int16_t index = bcache_allocate(cluster_number + i + j);
+            memcpy(&bcache_state.entry[index].data, &bcache_prefetch_buffer[j], CLUSTER_SIZE);
+            bcache_state.entry[index].prefetched = true;
+            filled[filled_count++] = index;
+        }
+        i += run;
+    }
+
+    // Prefetched cluster wait at cold end, hot cluster is not pushed out until bcache_read() hit promote it.
+    // Moved only after every run is allocated so prefetch never evict itself, farthest cluster is evicted first
+    for (uint32_t k = 0; k < filled_count; k++)
+    {
+        bcache_lru_unlink(filled[k]);
+        bcache_lru_push_back(filled[k]);
+    }
+}
+
+void bcache_write(const void *ptr, uint32_t cluster_number, uint32_t cluster_count)
+{
+    bool fill       = cluster_count <= BCACHE_FILL_LIMIT;
+    bool write_back = fill && bcache_state.policy == BCACHE_WRITE_BACK;
+    for (uint32_t i = 0; i < cluster_count; i++)
+    {
+        int16_t index = bcache_lookup(cluster_number + i);
+        if (index == BCACHE_NO_ENTRY && !fill)
+            continue;
+        if (index == BCACHE_NO_ENTRY)
+            index = bcache_allocate(cluster_number + i);
+        else
+            bcache_touch(index);
+
+        // Age count from first unwritten change
+        struct BufferCacheEntry *entry = &bcache_state.entry[index];
+        memcpy(&entry->data, (const uint8_t *)ptr + i * CLUSTER_SIZE, CLUSTER_SIZE);
+        if (write_back && !entry->dirty)
+            entry->dirty_epoch = bcache_state.epoch;
+        entry->dirty = write_back;
+    }
+
+    // Transfer too large to be cached always go straight into disk
+    if (!write_back)
+        write_blocks(ptr, cluster_to_lba(cluster_number), cluster_count * CLUSTER_BLOCK_COUNT);
+}
+
+void bcache_store(const void *ptr, uint32_t cluster_number, uint32_t cluster_count)
+{
+    for (uint32_t i = 0; i < cluster_count; i++)
+    {
+        int16_t index = bcache_lookup(cluster_number + i);
+        if (index == BCACHE_NO_ENTRY)
+            index = bcache_allocate(cluster_number + i);
+        else
+            bcache_touch(index);
+
+        // Older dirty content is superseded, whoever called this own writing the new content
+        memcpy(&bcache_state.entry[index].data, (const uint8_t *)ptr + i * CLUSTER_SIZE, CLUSTER_SIZE);
+        bcache_state.entry[index].dirty      = false;
+        bcache_state.entry[index].prefetched = false;
+    }
+}
+
+void bcache_discard(uint32_t cluster_number, uint32_t cluster_count)
+{
+    for (uint32_t i = 0; i < cluster_count; i++)
+    {
+        int16_t index = bcache_lookup(cluster_number + i);
+        if (index == BCACHE_NO_ENTRY)
+            continue;
+
+        struct BufferCacheEntry *entry = &bcache_state.entry[index];
+        if (entry->dirty)
+            bcache_state.statistics.discard++;
+        bcache_hash_remove(index);
+        entry->valid = false;
+        entry->dirty = false;
+        bcache_lru_unlink(index);
+        bcache_lru_push_back(index);
+    }
+}
+
+void bcache_flush(void)
+{
+    disk_plug();
+    for (int16_t i = 0; i < bcache_state.capacity; i++)
+    {
+        struct BufferCacheEntry *entry = &bcache_state.entry[i];
+        if (entry->valid && entry->dirty)
+        {
+            write_blocks(&entry->data, cluster_to_lba(entry->cluster_number), CLUSTER_BLOCK_COUNT);
+            entry->dirty = false;
+            bcache_state.statistics.write_back++;
+        }
+    }
+    disk_unplug();
+    disk_dispatch();
+}
+
+uint32_t bcache_writeback(void)
+{
+    bcache_state.epoch++;
+    uint16_t dirty_count = 0;
+    for (int16_t i = 0; i < bcache_state.capacity; i++)
+    {
+        if (bcache_state.entry[i].valid && bcache_state.entry[i].dirty)
+            dirty_count++;
+    }
+    bool flush_all = dirty_count * 100 >= bcache_state.capacity * BCACHE_DIRTY_RATIO;
+
+    uint32_t written = 0;
+    disk_plug();
+    for (int16_t i = 0; i < bcache_state.capacity; i++)
+    {
+        struct BufferCacheEntry *entry = &bcache_state.entry[i];
+        if (!entry->valid || !entry->dirty)
+            continue;
+        if (!flush_all && bcache_state.epoch - entry->dirty_epoch < BCACHE_WRITEBACK_EXPIRE)
+            continue;
+
+        write_blocks(&entry->data, cluster_to_lba(entry->cluster_number), CLUSTER_BLOCK_COUNT);
+        entry->dirty = false;
+        bcache_state.statistics.write_back++;
+        written++;
+    }
+    disk_unplug();
+    disk_dispatch();
+    return written;
+}
+
+void bcache_statistics(struct BufferCacheStatistics *statistics)
+{
+    *statistics = bcache_state.statistics;
+}
@@ -0,0 +1,139 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "header/stdlib/string.h"
+#include "header/filesystem/dcache.h"
+
+static struct DentryCacheState dcache_state = {0};
+
+// FNV-1a over parent cluster, name and extension
+static uint32_t dcache_hash(uint32_t parent_cluster_number, const char *name, const char *ext)
+{
+    uint32_t hash = 2166136261u ^ parent_cluster_number;
+    for (uint8_t i = 0; i < 8; i++)
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    for (uint8_t i = 0; i < 3; i++)
+        hash = (hash ^ (uint8_t)ext[i]) * 16777619u;
+    return hash % DCACHE_HASH_SIZE;
+}
+
+static int16_t dcache_find(uint32_t parent_cluster_number, const char *name, const char *ext)
+{
+    int16_t index = dcache_state.hash_head[dcache_hash(parent_cluster_number, name, ext)];
+    while (index != DCACHE_NO_ENTRY)
+    {
+        struct DentryCacheEntry *entry = &dcache_state.entry[index];
+        if (entry->parent_cluster_number == parent_cluster_number && !memcmp(entry->name, name, 8) && !memcmp(entry->ext, ext, 3))
+            return index;
+        index = entry->hash_next;
+    }
+    return DCACHE_NO_ENTRY;
+}
+
+static void dcache_remove(int16_t index)
+{
+    struct DentryCacheEntry *entry = &dcache_state.entry[index];
+    int16_t *link = &dcache_state.hash_head[dcache_hash(entry->parent_cluster_number, entry->name, entry->ext)];
+    while (*link != index)
+        link = &dcache_state.entry[*link].hash_next;
+    *link        = entry->hash_next;
+    entry->valid = false;
+}
+
+// Unused entry if there is one, otherwise least recently used entry is evicted
+static int16_t dcache_allocate(void)
+{
+    int16_t victim = 0;
+    for (int16_t i = 0; i < DCACHE_CAPACITY; i++)
+    {
+        if (!dcache_state.entry[i].valid)
+            return i;
+        if (dcache_state.entry[i].last_used < dcache_state.entry[victim].last_used)
+            victim = i;
+    }
+    dcache_remove(victim);
+    return victim;
+}
+
+/* -- Dentry cache interfaces -- */
+
+void initialize_dentry_cache(void)
+{
+    for (uint16_t i = 0; i < DCACHE_HASH_SIZE; i++)
+        dcache_state.hash_head[i] = DCACHE_NO_ENTRY;
+    for (int16_t i = 0; i < DCACHE_CAPACITY; i++)
+        dcache_state.entry[i].valid = false;
+    dcache_state.clock = 0;
+    memset(&dcache_state.statistics, 0, sizeof(struct DentryCacheStatistics));
+}
+
+struct DentryCacheEntry *dcache_lookup(uint32_t parent_cluster_number, const char *name, const char *ext)
+{
+    int16_t index = dcache_find(parent_cluster_number, name, ext);
+    if (index == DCACHE_NO_ENTRY)
+    {
+        dcache_state.statistics.miss++;
+        return NULL;
+    }
+
+    struct DentryCacheEntry *entry = &dcache_state.entry[index];
+    entry->last_used = ++dcache_state.clock;
+    if (entry->negative)
+        dcache_state.statistics.negative_hit++;
+    else
+        dcache_state.statistics.hit++;
+    return entry;
+}
+
+struct DentryCacheEntry *dcache_insert(uint32_t parent_cluster_number, const char *name, const char *ext, const struct FAT32DirectoryEntry *entry)
+{
+    int16_t index = dcache_find(parent_cluster_number, name, ext);
+    if (index == DCACHE_NO_ENTRY)
+    {
+        index = dcache_allocate();
+
+        struct DentryCacheEntry *dentry = &dcache_state.entry[index];
+        uint32_t bucket                 = dcache_hash(parent_cluster_number, name, ext);
+        memcpy(dentry->name, name, 8);
+        memcpy(dentry->ext, ext, 3);
+        dentry->parent_cluster_number  = parent_cluster_number;
+        dentry->valid                  = true;
+        dentry->hash_next              = dcache_state.hash_head[bucket];
+        dcache_state.hash_head[bucket] = index;
+    }
+
+    struct DentryCacheEntry *dentry = &dcache_state.entry[index];
+    dentry->negative       = entry == NULL;
+    dentry->attribute      = entry != NULL ? entry->attribute : 0;
+    dentry->cluster_number = entry != NULL ? (uint32_t)entry->cluster_high << 16 | entry->cluster_low : 0;
+    dentry->last_used      = ++dcache_state.clock;
+    return dentry;
+}
+
+void dcache_invalidate(uint32_t parent_cluster_number, const char *name, const char *ext)
+{
+    int16_t index = dcache_find(parent_cluster_number, name, ext);
+    if (index != DCACHE_NO_ENTRY)
+    {
+        dcache_remove(index);
+        dcache_state.statistics.invalidation++;
+    }
+}
+
+void dcache_invalidate_directory(uint32_t parent_cluster_number)
+{
+    for (int16_t i = 0; i < DCACHE_CAPACITY; i++)
+    {
+        struct DentryCacheEntry *entry = &dcache_state.entry[i];
+        if (entry->valid && entry->parent_cluster_number == parent_cluster_number)
+        {
+            dcache_remove(i);
+            dcache_state.statistics.invalidation++;
+        }
+    }
+}
+
+void dcache_statistics(struct DentryCacheStatistics *statistics)
+{
+    *statistics = dcache_state.statistics;
+}
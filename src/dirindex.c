@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "header/stdlib/string.h"
+#include "header/filesystem/dirindex.h"
+
+static struct DirectoryIndexState dirindex_state = {0};
+
+// FNV-1a over directory cluster, name and extension
+static uint32_t dirindex_hash(uint32_t dir_cluster, const char *name, const char *ext)
+{
+    uint32_t hash = 2166136261u ^ dir_cluster;
+    for (uint8_t i = 0; i < 8; i++)
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    for (uint8_t i = 0; i < 3; i++)
+        hash = (hash ^ (uint8_t)ext[i]) * 16777619u;
+    return hash % DIRINDEX_HASH_SIZE;
+}
+
+static void dirindex_hash_remove(int16_t index)
+{
+    struct DirectoryIndexNode *node = &dirindex_state.node[index];
+    uint32_t dir_cluster            = dirindex_state.directory[node->directory].dir_cluster;
+    int16_t *link = &dirindex_state.hash_head[dirindex_hash(dir_cluster, node->name, node->ext)];
+    while (*link != index)
+        link = &dirindex_state.node[*link].hash_next;
+    *link = node->hash_next;
+}
+
+// Return every node of directory into free list and invalidate the record
+static void dirindex_release(struct DirectoryIndex *directory)
+{
+    int16_t index = directory->node_head;
+    while (index != DIRINDEX_NO_NODE)
+    {
+        int16_t next = dirindex_state.node[index].directory_next;
+        dirindex_hash_remove(index);
+        dirindex_state.node[index].directory_next = dirindex_state.free_node;
+        dirindex_state.free_node                  = index;
+        index = next;
+    }
+    directory->valid      = false;
+    directory->node_head  = DIRINDEX_NO_NODE;
+    directory->node_count = 0;
+}
+
+// Least recently used valid directory other than keep, NULL if there is none
+static struct DirectoryIndex *dirindex_victim(struct DirectoryIndex *keep)
+{
+    struct DirectoryIndex *victim = NULL;
+    for (uint8_t i = 0; i < DIRINDEX_DIRECTORY_COUNT; i++)
+    {
+        struct DirectoryIndex *directory = &dirindex_state.directory[i];
+        if (directory == keep || !directory->valid)
+            continue;
+        if (victim == NULL || directory->last_used < victim->last_used)
+            victim = directory;
+    }
+    return victim;
+}
+
+/* -- Directory index interfaces -- */
+
+void initialize_directory_index(void)
+{
+    for (uint16_t i = 0; i < DIRINDEX_HASH_SIZE; i++)
+        dirindex_state.hash_head[i] = DIRINDEX_NO_NODE;
+
+    for (int16_t i = 0; i < DIRINDEX_NODE_COUNT; i++)
+        dirindex_state.node[i].directory_next = i + 1 < DIRINDEX_NODE_COUNT ? i + 1 : DIRINDEX_NO_NODE;
+    dirindex_state.free_node = 0;
+
+    for (uint8_t i = 0; i < DIRINDEX_DIRECTORY_COUNT; i++)
+    {
+        dirindex_state.directory[i].valid      = false;
+        dirindex_state.directory[i].node_head  = DIRINDEX_NO_NODE;
+        dirindex_state.directory[i].node_count = 0;
+    }
+    dirindex_state.clock = 0;
+}
+
+struct DirectoryIndex *dirindex_get(uint32_t dir_cluster)
+{
+    for (uint8_t i = 0; i < DIRINDEX_DIRECTORY_COUNT; i++)
+    {
+        struct DirectoryIndex *directory = &dirindex_state.directory[i];
+        if (directory->valid && directory->dir_cluster == dir_cluster)
+        {
+            directory->last_used = ++dirindex_state.clock;
+            return directory;
+        }
+    }
+    return NULL;
+}
+
+struct DirectoryIndex *dirindex_create(uint32_t dir_cluster)
+{
+    dirindex_drop(dir_cluster);
+
+    struct DirectoryIndex *directory = NULL;
+    for (uint8_t i = 0; i < DIRINDEX_DIRECTORY_COUNT && directory == NULL; i++)
+    {
+        if (!dirindex_state.directory[i].valid)
+            directory = &dirindex_state.directory[i];
+    }
+    if (directory == NULL)
+    {
+        directory = dirindex_victim(NULL);
+        dirindex_release(directory);
+    }
+
+    directory->dir_cluster       = dir_cluster;
+    directory->valid             = true;
+    directory->last_used         = ++dirindex_state.clock;
+    directory->free_slot_count   = 0;
+    directory->free_slot_cluster = dir_cluster;
+    directory->last_cluster      = dir_cluster;
+    return directory;
+}
+
+bool dirindex_insert(struct DirectoryIndex *directory, const struct FAT32DirectoryEntry *entry, uint32_t slot_cluster, uint16_t slot_index)
+{
+    while (dirindex_state.free_node == DIRINDEX_NO_NODE)
+    {
+        struct DirectoryIndex *victim = dirindex_victim(directory);
+        if (victim == NULL)
+            return false;
+        dirindex_release(victim);
+    }
+
+    int16_t index                   = dirindex_state.free_node;
+    struct DirectoryIndexNode *node = &dirindex_state.node[index];
+    dirindex_state.free_node        = node->directory_next;
+
+    memcpy(node->name, entry->name, 8);
+    memcpy(node->ext, entry->ext, 3);
+    node->directory     = directory - dirindex_state.directory;
+    node->slot_index    = slot_index;
+    node->slot_cluster  = slot_cluster;
+    node->first_cluster = entry->cluster_low | (entry->cluster_high << 16);
+
+    uint32_t bucket                  = dirindex_hash(directory->dir_cluster, entry->name, entry->ext);
+    node->hash_next                  = dirindex_state.hash_head[bucket];
+    dirindex_state.hash_head[bucket] = index;
+
+    node->directory_prev = DIRINDEX_NO_NODE;
+    node->directory_next = directory->node_head;
+    if (directory->node_head != DIRINDEX_NO_NODE)
+        dirindex_state.node[directory->node_head].directory_prev = index;
+    directory->node_head = index;
+    directory->node_count++;
+    return true;
+}
+
+struct DirectoryIndexNode *dirindex_lookup(struct DirectoryIndex *directory, const char *name, const char *ext)
+{
+    uint8_t position = directory - dirindex_state.directory;
+    int16_t index    = dirindex_state.hash_head[dirindex_hash(directory->dir_cluster, name, ext)];
+    while (index != DIRINDEX_NO_NODE)
+    {
+        struct DirectoryIndexNode *node = &dirindex_state.node[index];
+        if (node->directory == position && !memcmp(node->name, name, 8) && !memcmp(node->ext, ext, 3))
+            return node;
+        index = node->hash_next;
+    }
+    return NULL;
+}
+
+void dirindex_remove(struct DirectoryIndex *directory, const char *name, const char *ext)
+{
+    struct DirectoryIndexNode *node = dirindex_lookup(directory, name, ext);
+    if (node == NULL)
+        return;
+
+    int16_t index = node - dirindex_state.node;
+    if (node->directory_prev != DIRINDEX_NO_NODE)
+        dirindex_state.node[node->directory_prev].directory_next = node->directory_next;
+    else
+        directory->node_head = node->directory_next;
+    if (node->directory_next != DIRINDEX_NO_NODE)
+        dirindex_state.node[node->directory_next].directory_prev = node->directory_prev;
+
+    dirindex_hash_remove(index);
+    node->directory_next     = dirindex_state.free_node;
+    dirindex_state.free_node = index;
+    directory->node_count--;
+}
+
+void dirindex_drop(uint32_t dir_cluster)
+{
+    for (uint8_t i = 0; i < DIRINDEX_DIRECTORY_COUNT; i++)
+    {
+        struct DirectoryIndex *directory = &dirindex_state.directory[i];
+        if (directory->valid && directory->dir_cluster == dir_cluster)
+            dirindex_release(directory);
+    }
+}
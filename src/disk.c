@@ -1,46 +1,495 @@
 #include "header/driver/disk.h"
+#include "header/driver/idedma.h"
+#include "header/driver/iostat.h"
 #include "header/cpu/portio.h"
+#include "header/cpu/interrupt.h"
+#include "header/process/process.h"
+
+static struct ATADriverState ata_state = {
+    .drive_present         = false,
+    .multiple_sector_count = 1,
+    .dma_enabled           = false,
+    .interrupt_enabled     = false,
+    .lba48_enabled         = false,
+    .total_block_count     = 0,
+};
+
+static struct ATARequestQueue ata_queue = {
+    .head  = 0,
+    .count = 0,
+};
+
+static struct ATAPlugList ata_plug = {
+    .depth = 0,
+    .count = 0,
+};
+
+static struct ATASchedulerStatistics ata_statistics = {0};
+
+// Request built from plug list on dispatch, plug list is only dispatched from one context at a time
+static struct ATARequest ata_plug_request[ATA_PLUG_LIST_SIZE];
 
 static void ATA_busy_wait() {
-    while (in(0x1F7) & ATA_STATUS_BSY);
+    while (in(ATA_PRIMARY_STATUS) & ATA_STATUS_BSY);
 }
 
 static void ATA_DRQ_wait() {
-    while (!(in(0x1F7) & ATA_STATUS_RDY));
+    while (!(in(ATA_PRIMARY_STATUS) & (ATA_STATUS_DRQ | ATA_STATUS_ERR)));
+}
+
+// Reading alternate status 4 times give the drive 400ns to update status after command is sent
+static void ATA_delay_400ns() {
+    for (uint8_t i = 0; i < 4; i++)
+        in(ATA_PRIMARY_ALT_STATUS);
+}
+
+// Sector count 0 mean 256 sector
+static void ATA_select_lba28(uint32_t logical_block_address, uint16_t block_count) {
+    out(ATA_PRIMARY_DRIVE_SELECT, 0xE0 | ((logical_block_address >> 24) & 0xF));
+    out(ATA_PRIMARY_SECTOR_COUNT, (uint8_t)block_count);
+    out(ATA_PRIMARY_LBA_LOW, (uint8_t)logical_block_address);
+    out(ATA_PRIMARY_LBA_MID, (uint8_t)(logical_block_address >> 8));
+    out(ATA_PRIMARY_LBA_HIGH, (uint8_t)(logical_block_address >> 16));
+}
+
+// Each register is written twice, high order byte first. Block address bit 32-47 is always 0
+static void ATA_select_lba48(uint32_t logical_block_address, uint16_t block_count) {
+    out(ATA_PRIMARY_DRIVE_SELECT, 0x40);
+    out(ATA_PRIMARY_SECTOR_COUNT, (uint8_t)(block_count >> 8));
+    out(ATA_PRIMARY_LBA_LOW, (uint8_t)(logical_block_address >> 24));
+    out(ATA_PRIMARY_LBA_MID, 0);
+    out(ATA_PRIMARY_LBA_HIGH, 0);
+    out(ATA_PRIMARY_SECTOR_COUNT, (uint8_t)block_count);
+    out(ATA_PRIMARY_LBA_LOW, (uint8_t)logical_block_address);
+    out(ATA_PRIMARY_LBA_MID, (uint8_t)(logical_block_address >> 8));
+    out(ATA_PRIMARY_LBA_HIGH, (uint8_t)(logical_block_address >> 16));
+}
+
+// LBA28 command is cheaper to program, LBA48 only used when address or count does not fit
+static bool ATA_need_lba48(uint32_t logical_block_address, uint16_t block_count) {
+    return ata_state.lba48_enabled && (block_count > ATA_LBA28_MAX_BLOCK_COUNT
+        || logical_block_address + block_count - 1 > ATA_LBA28_MAX_ADDRESS);
 }
 
-void read_blocks(void* ptr, uint32_t logical_block_address, uint8_t block_count) {
+static uint16_t ATA_max_block_per_command() {
+    return ata_state.lba48_enabled ? ATA_MAX_BLOCK_PER_COMMAND : ATA_LBA28_MAX_BLOCK_COUNT;
+}
+
+// Disable interrupt and return whether interrupt flag was set before
+static bool ATA_interrupt_save_disable() {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags) : /* <Empty> */ : "memory");
+    return eflags & CPU_EFLAGS_FLAG_INTERRUPT_ENABLE;
+}
+
+static void ATA_interrupt_restore(bool interrupt_enabled) {
+    if (interrupt_enabled)
+        __asm__ volatile("sti");
+}
+
+/* -- PIO & DMA transfer -- */
+
+// Move one DRQ block (up to multiple_sector_count sector) between data port and request segments
+static void ATA_transfer_drq_block(struct ATARequest *request) {
+    uint32_t remaining = request->block_count - request->block_done;
+    uint32_t chunk     = remaining < ata_state.multiple_sector_count ? remaining : ata_state.multiple_sector_count;
+    while (chunk > 0) {
+        struct ATASegment *segment = &request->segment[request->segment_index];
+        uint32_t in_segment = segment->block_count - request->segment_block_done;
+        uint32_t length     = chunk < in_segment ? chunk : in_segment;
+        uint8_t  *buf       = (uint8_t*)segment->buf + request->segment_block_done * BLOCK_SIZE;
+        if (request->write)
+            out16_rep(ATA_PRIMARY_DATA, buf, length * HALF_BLOCK_SIZE);
+        else
+            in16_rep(ATA_PRIMARY_DATA, buf, length * HALF_BLOCK_SIZE);
+
+        request->block_done         += length;
+        request->segment_block_done += length;
+        if (request->segment_block_done == segment->block_count) {
+            request->segment_index++;
+            request->segment_block_done = 0;
+        }
+        chunk -= length;
+    }
+}
+
+// Program task file and send command, for PIO write the first DRQ block is sent here
+static void ATA_issue_command(struct ATARequest *request) {
+    request->use_dma            = ata_state.dma_enabled && ide_dma_prepare(request->segment, request->segment_count, !request->write);
+    request->block_done         = 0;
+    request->segment_index      = 0;
+    request->segment_block_done = 0;
+    if (request->write) {
+        ata_statistics.command_write++;
+        ata_statistics.block_written += request->block_count;
+    } else {
+        ata_statistics.command_read++;
+        ata_statistics.block_read += request->block_count;
+    }
+
+    bool    lba48 = ATA_need_lba48(request->logical_block_address, request->block_count);
+    uint8_t command;
+    if (request->use_dma && lba48)
+        command = request->write ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT;
+    else if (request->use_dma)
+        command = request->write ? ATA_CMD_WRITE_DMA : ATA_CMD_READ_DMA;
+    else if (ata_state.multiple_sector_count > 1 && lba48)
+        command = request->write ? ATA_CMD_WRITE_MULTIPLE_EXT : ATA_CMD_READ_MULTIPLE_EXT;
+    else if (ata_state.multiple_sector_count > 1)
+        command = request->write ? ATA_CMD_WRITE_MULTIPLE : ATA_CMD_READ_MULTIPLE;
+    else if (lba48)
+        command = request->write ? ATA_CMD_WRITE_PIO_EXT : ATA_CMD_READ_PIO_EXT;
+    else
+        command = request->write ? ATA_CMD_WRITE_PIO : ATA_CMD_READ_PIO;
+
     ATA_busy_wait();
-    out(0x1F6, 0xE0 | ((logical_block_address >> 24) & 0xF));
-    out(0x1F2, block_count);
-    out(0x1F3, (uint8_t)logical_block_address);
-    out(0x1F4, (uint8_t)(logical_block_address >> 8));
-    out(0x1F5, (uint8_t)(logical_block_address >> 16));
-    out(0x1F7, 0x20);
-
-    uint16_t* target = (uint16_t*)ptr;
-    for (uint32_t i = 0; i < block_count; i++) {
+    if (lba48)
+        ATA_select_lba48(request->logical_block_address, request->block_count);
+    else
+        ATA_select_lba28(request->logical_block_address, request->block_count);
+    out(ATA_PRIMARY_COMMAND, command);
+    ATA_delay_400ns();
+
+    if (request->use_dma) {
+        ide_dma_start();
+    } else if (request->write) {
         ATA_busy_wait();
         ATA_DRQ_wait();
-        for (uint32_t j = 0; j < HALF_BLOCK_SIZE; j++)
-            target[j] = in16(0x1F0);
-        target += HALF_BLOCK_SIZE;
+        ATA_transfer_drq_block(request);
     }
 }
 
-void write_blocks(const void* ptr, uint32_t logical_block_address, uint8_t block_count) {
+// Serve whole request with status polling, used before drive interrupt is enabled
+static void ATA_execute_polled(struct ATARequest *request) {
+    ATA_issue_command(request);
+    if (request->use_dma) {
+        while (!ide_dma_is_done());
+        request->success = ide_dma_finish();
+    } else {
+        while (request->block_done < request->block_count) {
+            ATA_busy_wait();
+            ATA_DRQ_wait();
+            ATA_transfer_drq_block(request);
+        }
+        ATA_busy_wait();
+        request->success = !(in(ATA_PRIMARY_STATUS) & (ATA_STATUS_ERR | ATA_STATUS_DF));
+    }
+    request->completed = true;
+}
+
+/* -- Request queue -- */
+
+static struct ATARequest* ATA_queue_front() {
+    return ata_queue.count > 0 ? ata_queue.request[ata_queue.head] : NULL;
+}
+
+static void ATA_queue_push(struct ATARequest *request) {
+    // Submitter block until its whole batch completes, so queue only ever hold one batch. Single read / write
+    // is one request, only plug list dispatch queue many. Batch bigger than queue wait here for IRQ to free a slot
+    while (ata_queue.count >= ATA_REQUEST_QUEUE_SIZE)
+        __asm__ volatile("sti; hlt; cli");
+
+    uint8_t tail = (ata_queue.head + ata_queue.count) % ATA_REQUEST_QUEUE_SIZE;
+    ata_queue.request[tail] = request;
+    ata_queue.count++;
+    if (ata_queue.count == 1)
+        ATA_issue_command(request);
+}
+
+static void ATA_queue_complete_front(bool success) {
+    struct ATARequest *request = ATA_queue_front();
+    request->success   = success;
+    request->completed = true;
+    if (request->waiting_process != NULL)
+        request->waiting_process->metadata.state = PROCESS_STATE_READY;
+
+    ata_queue.head = (ata_queue.head + 1) % ATA_REQUEST_QUEUE_SIZE;
+    ata_queue.count--;
+    if (ata_queue.count > 0)
+        ATA_issue_command(ATA_queue_front());
+}
+
+// Queue every request and block until all of them completed, requests are served in array order
+static void ATA_submit_and_wait(struct ATARequest **request, uint8_t request_count) {
+    for (uint8_t i = 0; i < request_count; i++) {
+        request[i]->completed       = false;
+        request[i]->success         = false;
+        request[i]->waiting_process = NULL;
+    }
+
+    if (!ata_state.interrupt_enabled) {
+        for (uint8_t i = 0; i < request_count; i++)
+            ATA_execute_polled(request[i]);
+    } else {
+        bool interrupt_was_enabled = ATA_interrupt_save_disable();
+        // Queue is FIFO, last request completing mean every request is completed
+        struct ProcessControlBlock *current_pcb = process_get_current_running_pcb_pointer();
+        if (current_pcb != NULL) {
+            request[request_count - 1]->waiting_process = current_pcb;
+            current_pcb->metadata.state                 = PROCESS_STATE_WAITING;
+        }
+        for (uint8_t i = 0; i < request_count; i++)
+            ATA_queue_push(request[i]);
+
+        // sti only take effect after hlt, so completion IRQ cannot slip between the check and hlt
+        while (!request[request_count - 1]->completed)
+            __asm__ volatile("sti; hlt; cli" : : : "memory");
+        ATA_interrupt_restore(interrupt_was_enabled);
+    }
+
+    // DMA failure (ex: buffer not reachable by controller) is retried once with PIO
+    for (uint8_t i = 0; i < request_count; i++) {
+        if (!request[i]->success && request[i]->use_dma) {
+            bool dma_enabled      = ata_state.dma_enabled;
+            ata_state.dma_enabled = false;
+            ATA_execute_polled(request[i]);
+            ata_state.dma_enabled = dma_enabled;
+        }
+    }
+}
+
+static void ATA_submit_single(void *buf, uint32_t logical_block_address, uint16_t block_count, bool write) {
+    if (block_count == 0)
+        return;
+
+    struct ATARequest request = {
+        .segment               = {{.buf = buf, .block_count = block_count}},
+        .segment_count         = 1,
+        .logical_block_address = logical_block_address,
+        .block_count           = block_count,
+        .write                 = write,
+    };
+    struct ATARequest *request_list[1] = {&request};
+    ATA_submit_and_wait(request_list, 1);
+}
+
+/* -- I/O scheduler -- */
+
+static bool ATA_range_overlap(uint32_t start_a, uint32_t count_a, uint32_t start_b, uint32_t count_b) {
+    return start_a < start_b + count_b && start_b < start_a + count_a;
+}
+
+// Sort pending write by LBA, merge LBA-adjacent write into one command, then dispatch all
+static void ATA_plug_dispatch() {
+    if (ata_plug.count == 0)
+        return;
+
+    // Insertion sort, stable so write into the same block keep submission order
+    uint8_t order[ATA_PLUG_LIST_SIZE];
+    for (uint8_t i = 0; i < ata_plug.count; i++) {
+        uint8_t j = i;
+        while (j > 0 && ata_plug.lba[order[j - 1]] > ata_plug.lba[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    for (uint8_t i = 0; i < ata_plug.count; i++)
+        if (order[i] != i)
+            ata_statistics.write_reordered++;
+
+    struct ATARequest *request_list[ATA_PLUG_LIST_SIZE];
+    uint8_t request_count = 0;
+    for (uint8_t i = 0; i < ata_plug.count; i++) {
+        struct ATASegment *write   = &ata_plug.write[order[i]];
+        uint32_t          lba      = ata_plug.lba[order[i]];
+        struct ATARequest *last    = request_count > 0 ? request_list[request_count - 1] : NULL;
+        bool              mergable = last != NULL
+            && last->logical_block_address + last->block_count == lba
+            && last->block_count + write->block_count <= ATA_max_block_per_command()
+            && last->segment_count < ATA_REQUEST_SEGMENT_MAX;
+
+        if (mergable) {
+            last->segment[last->segment_count++] = *write;
+            last->block_count                   += write->block_count;
+            ata_statistics.write_merged++;
+        } else {
+            struct ATARequest *request     = &ata_plug_request[request_count];
+            request->segment[0]            = *write;
+            request->segment_count         = 1;
+            request->logical_block_address = lba;
+            request->block_count           = write->block_count;
+            request->write                 = true;
+            request_list[request_count++]  = request;
+        }
+    }
+
+    ata_plug.count = 0;
+    ATA_submit_and_wait(request_list, request_count);
+}
+
+static bool ATA_plug_overlap(uint32_t logical_block_address, uint32_t block_count) {
+    for (uint8_t i = 0; i < ata_plug.count; i++)
+        if (ATA_range_overlap(ata_plug.lba[i], ata_plug.write[i].block_count, logical_block_address, block_count))
+            return true;
+    return false;
+}
+
+// Read into buffer of pending write will corrupt the data going to be written
+static bool ATA_plug_buffer_overlap(const void *buf, uint32_t block_count) {
+    for (uint8_t i = 0; i < ata_plug.count; i++)
+        if (ATA_range_overlap((uint32_t)ata_plug.write[i].buf, ata_plug.write[i].block_count * BLOCK_SIZE,
+                (uint32_t)buf, block_count * BLOCK_SIZE))
+            return true;
+    return false;
+}
+
+static void ATA_plug_add(const void *ptr, uint32_t logical_block_address, uint16_t block_count) {
+    // Newer write of exactly the same blocks supersede pending one
+    for (uint8_t i = 0; i < ata_plug.count; i++) {
+        if (ata_plug.lba[i] == logical_block_address && ata_plug.write[i].block_count == block_count) {
+            ata_plug.write[i].buf = (void*)ptr;
+            ata_statistics.write_replaced++;
+            return;
+        }
+    }
+
+    // Partial overlap cannot be merged safely, write everything pending first
+    if (ata_plug.count >= ATA_PLUG_LIST_SIZE || ATA_plug_overlap(logical_block_address, block_count))
+        ATA_plug_dispatch();
+
+    ata_plug.write[ata_plug.count].buf         = (void*)ptr;
+    ata_plug.write[ata_plug.count].block_count = block_count;
+    ata_plug.lba[ata_plug.count]               = logical_block_address;
+    ata_plug.count++;
+    ata_statistics.write_queued++;
+}
+
+/* -- Driver Interfaces -- */
+
+void initialize_disk(void) {
+    struct BlockBuffer identify;
+    uint16_t *identify_word = (uint16_t*)identify.buf;
+
+    // Keep drive interrupt off while identifying, everything here is polled
+    out(ATA_PRIMARY_CONTROL, ATA_CONTROL_NIEN);
+    out(ATA_PRIMARY_DRIVE_SELECT, 0xA0);
+    out(ATA_PRIMARY_SECTOR_COUNT, 0);
+    out(ATA_PRIMARY_LBA_LOW, 0);
+    out(ATA_PRIMARY_LBA_MID, 0);
+    out(ATA_PRIMARY_LBA_HIGH, 0);
+    out(ATA_PRIMARY_COMMAND, ATA_CMD_IDENTIFY);
+    ATA_delay_400ns();
+    if (in(ATA_PRIMARY_STATUS) == 0)
+        return;
+
     ATA_busy_wait();
-    out(0x1F6, 0xE0 | ((logical_block_address >> 24) & 0xF));
-    out(0x1F2, block_count);
-    out(0x1F3, (uint8_t)logical_block_address);
-    out(0x1F4, (uint8_t)(logical_block_address >> 8));
-    out(0x1F5, (uint8_t)(logical_block_address >> 16));
-    out(0x1F7, 0x30);
-
-    for (uint32_t i = 0; i < block_count; i++) {
+    ATA_DRQ_wait();
+    if (in(ATA_PRIMARY_STATUS) & ATA_STATUS_ERR)
+        return;
+    in16_rep(ATA_PRIMARY_DATA, identify_word, HALF_BLOCK_SIZE);
+    ata_state.drive_present = true;
+    ata_state.dma_enabled   = initialize_ide_dma();
+
+    ata_state.lba48_enabled = identify_word[ATA_IDENTIFY_COMMAND_SET_2] & ATA_IDENTIFY_LBA48_SUPPORTED;
+    if (ata_state.lba48_enabled)
+        ata_state.total_block_count = identify_word[ATA_IDENTIFY_LBA48_SECTORS]
+            | ((uint32_t)identify_word[ATA_IDENTIFY_LBA48_SECTORS + 1] << 16);
+    else
+        ata_state.total_block_count = identify_word[ATA_IDENTIFY_LBA28_SECTORS]
+            | ((uint32_t)identify_word[ATA_IDENTIFY_LBA28_SECTORS + 1] << 16);
+
+    // Use the largest DRQ block drive support, fallback to single sector PIO if rejected
+    uint8_t max_multiple = identify_word[ATA_IDENTIFY_MAX_MULTIPLE] & 0xFF;
+    if (max_multiple > 1) {
+        out(ATA_PRIMARY_DRIVE_SELECT, 0xE0);
+        out(ATA_PRIMARY_SECTOR_COUNT, max_multiple);
+        out(ATA_PRIMARY_COMMAND, ATA_CMD_SET_MULTIPLE_MODE);
+        ATA_delay_400ns();
         ATA_busy_wait();
-        ATA_DRQ_wait();
-        for (uint32_t j = 0; j < HALF_BLOCK_SIZE; j++)
-            out16(0x1F0, ((uint16_t*)ptr)[HALF_BLOCK_SIZE * i + j]);
+        if (!(in(ATA_PRIMARY_STATUS) & (ATA_STATUS_ERR | ATA_STATUS_DF)))
+            ata_state.multiple_sector_count = max_multiple;
+    }
+
+    out(ATA_PRIMARY_CONTROL, 0);
+    activate_disk_interrupt();
+    ata_state.interrupt_enabled = true;
+}
+
+void disk_isr(void) {
+    struct ATARequest *request = ATA_queue_front();
+    if (request == NULL) {
+        // Spurious or stale interrupt, reading status is enough to acknowledge drive
+        in(ATA_PRIMARY_STATUS);
+        pic_ack(IRQ_PRIMARY_ATA);
+        return;
+    }
+
+    if (request->use_dma) {
+        if (ide_dma_is_done())
+            ATA_queue_complete_front(ide_dma_finish());
+    } else {
+        uint8_t status = in(ATA_PRIMARY_STATUS);
+        if (status & (ATA_STATUS_ERR | ATA_STATUS_DF)) {
+            ATA_queue_complete_front(false);
+        } else if (request->block_done < request->block_count && (status & ATA_STATUS_DRQ)) {
+            // Read: data block is ready. Write: previous block accepted, drive want the next one
+            ATA_transfer_drq_block(request);
+            if (!request->write && request->block_done == request->block_count)
+                ATA_queue_complete_front(true);
+        } else if (request->write && request->block_done == request->block_count) {
+            ATA_queue_complete_front(true);
+        }
+    }
+    pic_ack(IRQ_PRIMARY_ATA);
+}
+
+void disk_plug(void) {
+    ata_plug.depth++;
+}
+
+void disk_unplug(void) {
+    if (ata_plug.depth == 0)
+        return;
+    if (--ata_plug.depth == 0)
+        ATA_plug_dispatch();
+}
+
+void disk_dispatch(void) {
+    ATA_plug_dispatch();
+}
+
+uint32_t disk_block_count(void) {
+    return ata_state.total_block_count;
+}
+
+void disk_scheduler_statistics(struct ATASchedulerStatistics *statistics) {
+    *statistics = ata_statistics;
+}
+
+void read_blocks(void* ptr, uint32_t logical_block_address, uint32_t block_count) {
+    uint64_t start = iostat_timestamp();
+    if (ATA_plug_overlap(logical_block_address, block_count) || ATA_plug_buffer_overlap(ptr, block_count))
+        ATA_plug_dispatch();
+
+    uint8_t  *buf      = (uint8_t*)ptr;
+    uint32_t remaining = block_count;
+    uint16_t max_chunk = ATA_max_block_per_command();
+    while (remaining > 0) {
+        uint16_t chunk = remaining < max_chunk ? remaining : max_chunk;
+        ATA_submit_single(buf, logical_block_address, chunk, false);
+        buf                   += chunk * BLOCK_SIZE;
+        logical_block_address += chunk;
+        remaining             -= chunk;
+    }
+    iostat_record(false, block_count, iostat_timestamp() - start);
+}
+
+void write_blocks(const void* ptr, uint32_t logical_block_address, uint32_t block_count) {
+    uint64_t      start     = iostat_timestamp();
+    bool          plugged   = ata_plug.depth > 0;
+    const uint8_t *buf      = (const uint8_t*)ptr;
+    uint32_t      remaining = block_count;
+    uint16_t      max_chunk = ATA_max_block_per_command();
+    while (remaining > 0) {
+        uint16_t chunk = remaining < max_chunk ? remaining : max_chunk;
+        if (plugged)
+            ATA_plug_add(buf, logical_block_address, chunk);
+        else
+            ATA_submit_single((void*)buf, logical_block_address, chunk, true);
+        buf                   += chunk * BLOCK_SIZE;
+        logical_block_address += chunk;
+        remaining             -= chunk;
     }
+    iostat_record(true, block_count, plugged ? 0 : iostat_timestamp() - start);
 }
@@ -0,0 +1,176 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "header/stdlib/string.h"
+#include "header/filesystem/extcache.h"
+
+static struct ExtentCacheState extcache_state = {0};
+
+static struct FileExtentMap *extcache_find(uint32_t first_cluster)
+{
+    for (uint8_t i = 0; i < EXTCACHE_FILE_COUNT; i++)
+    {
+        struct FileExtentMap *map = &extcache_state.map[i];
+        if (map->valid && map->first_cluster == first_cluster)
+            return map;
+    }
+    return NULL;
+}
+
+// Unused map if there is one, otherwise least recently used map is evicted
+static struct FileExtentMap *extcache_allocate(uint32_t first_cluster)
+{
+    struct FileExtentMap *victim = &extcache_state.map[0];
+    for (uint8_t i = 0; i < EXTCACHE_FILE_COUNT; i++)
+    {
+        struct FileExtentMap *map = &extcache_state.map[i];
+        if (!map->valid)
+        {
+            victim = map;
+            break;
+        }
+        if (map->last_used < victim->last_used)
+            victim = map;
+    }
+
+    victim->first_cluster = first_cluster;
+    victim->valid         = true;
+    victim->complete      = false;
+    victim->extent_count  = 0;
+    return victim;
+}
+
+// Known run containing cluster index, binary search over runs ordered by logical start
+static struct FileExtent *extcache_search(struct FileExtentMap *map, uint32_t cluster_index)
+{
+    uint16_t low = 0, high = map->extent_count;
+    while (low < high)
+    {
+        uint16_t middle           = (low + high) / 2;
+        struct FileExtent *extent = &map->extent[middle];
+        if (cluster_index < extent->logical_start)
+            high = middle;
+        else if (cluster_index >= extent->logical_start + extent->length)
+            low = middle + 1;
+        else
+            return extent;
+    }
+    return NULL;
+}
+
+/**
+ * Walk chain past the last known run and record one more run. Cluster contiguous with last run extend it
+ *
+ * @param map Map to extend, must not be complete
+ * @return    False if map has no room for another run, map is unchanged
+ */
+static bool extcache_extend(struct FileExtentMap *map)
+{
+    uint32_t logical_start  = 0;
+    uint32_t cluster_number = map->first_cluster;
+    struct FileExtent *last = map->extent_count > 0 ? &map->extent[map->extent_count - 1] : NULL;
+    if (last != NULL)
+    {
+        logical_start  = last->logical_start + last->length;
+        cluster_number = fat_get(last->physical_start + last->length - 1);
+        extcache_state.statistics.walked++;
+        if (cluster_number == FAT32_FAT_END_OF_FILE)
+        {
+            map->complete = true;
+            return true;
+        }
+    }
+
+    struct FileExtent *extent;
+    if (last != NULL && cluster_number == last->physical_start + last->length)
+        extent = last;
+    else if (map->extent_count < EXTCACHE_EXTENT_COUNT)
+    {
+        extent                 = &map->extent[map->extent_count++];
+        extent->logical_start  = logical_start;
+        extent->physical_start = cluster_number;
+        extent->length         = 0;
+    }
+    else
+        return false;
+
+    // Run end at first cluster whose successor is not the next cluster
+    uint32_t next_cluster;
+    do
+    {
+        extent->length++;
+        next_cluster = fat_get(extent->physical_start + extent->length - 1);
+        extcache_state.statistics.walked++;
+    } while (next_cluster == extent->physical_start + extent->length);
+    map->complete = next_cluster == FAT32_FAT_END_OF_FILE;
+    return true;
+}
+
+/* -- Extent cache interfaces -- */
+
+void initialize_extent_cache(void)
+{
+    for (uint8_t i = 0; i < EXTCACHE_FILE_COUNT; i++)
+        extcache_state.map[i].valid = false;
+    extcache_state.clock = 0;
+    memset(&extcache_state.statistics, 0, sizeof(struct ExtentCacheStatistics));
+}
+
+uint32_t extcache_map(uint32_t first_cluster, uint32_t cluster_index)
+{
+    struct FileExtentMap *map = extcache_find(first_cluster);
+    if (map == NULL)
+        map = extcache_allocate(first_cluster);
+    map->last_used = ++extcache_state.clock;
+
+    struct FileExtent *extent = extcache_search(map, cluster_index);
+    if (extent != NULL)
+    {
+        extcache_state.statistics.hit++;
+        return extent->physical_start + (cluster_index - extent->logical_start);
+    }
+
+    extcache_state.statistics.miss++;
+    while (!map->complete)
+    {
+        if (!extcache_extend(map))
+        {
+            // Map is full, walk the rest of chain from end of last run
+            struct FileExtent *last = &map->extent[map->extent_count - 1];
+            uint32_t cluster_number = last->physical_start + last->length - 1;
+            for (uint32_t i = last->logical_start + last->length - 1; i < cluster_index && cluster_number != FAT32_FAT_END_OF_FILE; i++)
+            {
+                cluster_number = fat_get(cluster_number);
+                extcache_state.statistics.walked++;
+            }
+            return cluster_number;
+        }
+
+        extent = &map->extent[map->extent_count - 1];
+        if (cluster_index < extent->logical_start + extent->length)
+            return extent->physical_start + (cluster_index - extent->logical_start);
+    }
+    return FAT32_FAT_END_OF_FILE;
+}
+
+void extcache_grow(uint32_t first_cluster)
+{
+    struct FileExtentMap *map = extcache_find(first_cluster);
+    if (map != NULL)
+        map->complete = false;
+}
+
+void extcache_invalidate(uint32_t first_cluster)
+{
+    struct FileExtentMap *map = extcache_find(first_cluster);
+    if (map != NULL)
+    {
+        map->valid = false;
+        extcache_state.statistics.invalidation++;
+    }
+}
+
+void extcache_statistics(struct ExtentCacheStatistics *statistics)
+{
+    *statistics = extcache_state.statistics;
+}
@@ -10,6 +10,7 @@
 // Global variable
 uint8_t* image_storage;
 uint8_t* file_buffer;
+size_t   image_size;
 
 
 char* get_filename(char* path) {
@@ -22,7 +23,7 @@ char* get_filename(char* path) {
     }
 }
 
-void read_blocks(void* ptr, uint32_t logical_block_address, uint8_t block_count) {
+void read_blocks(void* ptr, uint32_t logical_block_address, uint32_t block_count) {
     for (int i = 0; i < block_count; i++) {
         memcpy(
             (uint8_t*)ptr + BLOCK_SIZE * i,
@@ -32,7 +33,7 @@ void read_blocks(void* ptr, uint32_t logical_block_address, uint8_t block_count)
     }
 }
 
-void write_blocks(const void* ptr, uint32_t logical_block_address, uint8_t block_count) {
+void write_blocks(const void* ptr, uint32_t logical_block_address, uint32_t block_count) {
     for (int i = 0; i < block_count; i++) {
         memcpy(
             image_storage + BLOCK_SIZE * (logical_block_address + i),
@@ -42,6 +43,18 @@ void write_blocks(const void* ptr, uint32_t logical_block_address, uint8_t block
     }
 }
 
+// Image is in memory, nothing to gain from holding writes back
+void disk_plug(void) {}
+
+void disk_unplug(void) {}
+
+void disk_dispatch(void) {}
+
+// New file system is sized from the storage file
+uint32_t disk_block_count(void) {
+    return image_size / BLOCK_SIZE;
+}
+
 void split_by_first_inserter(char* pstr, char by, char* result) {
     int i = 0;
     while (pstr[i] != '\0' && pstr[i] != by) {
@@ -71,11 +84,14 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
-    // Read storage into memory, requiring 4 MB memory
-    image_storage = malloc(4 * 1024 * 1024);
-    file_buffer = malloc(4 * 1024 * 1024);
+    // Read whole storage into memory
     FILE* fptr = fopen(argv[3], "r");
-    fread(image_storage, 4 * 1024 * 1024, 1, fptr);
+    fseek(fptr, 0, SEEK_END);
+    image_size = ftell(fptr);
+    fseek(fptr, 0, SEEK_SET);
+    image_storage = malloc(image_size);
+    file_buffer = malloc(4 * 1024 * 1024);
+    fread(image_storage, image_size, 1, fptr);
     fclose(fptr);
 
     // Read target file, assuming file is less than 4 MiB
@@ -125,10 +141,11 @@ int main(int argc, char* argv[]) {
     case 2:  puts("Error: Invalid parent cluster"); break;
     default: puts("Error: Unknown error");
     }
+    sync_filesystem_fat32();
 
     // Write image in memory into original, overwrite them
     fptr = fopen(argv[3], "w");
-    fwrite(image_storage, 4 * 1024 * 1024, 1, fptr);
+    fwrite(image_storage, image_size, 1, fptr);
     fclose(fptr);
 
     return 0;
@@ -3,6 +3,12 @@
 #include <stddef.h>
 #include "header/stdlib/string.h"
 #include "header/filesystem/fat32.h"
+#include "header/filesystem/bcache.h"
+#include "header/filesystem/dirindex.h"
+#include "header/filesystem/dcache.h"
+#include "header/filesystem/extcache.h"
+#include "header/filesystem/journal.h"
+#include "header/driver/iostat.h"
 
 const uint8_t fs_signature[BLOCK_SIZE] = {
     'C',
@@ -91,6 +97,22 @@ const uint8_t fs_signature[BLOCK_SIZE] = {
 
 static struct FAT32DriverState driver_state = {0};
 
+static struct FAT32ClusterAllocator allocator_state = {0};
+
+// Readahead state of partial cluster read by pread(), shared by every file
+static struct FAT32Readahead file_readahead = {0};
+
+// Open file table, record is shared by every descriptor of the same file
+static struct FAT32OpenFile open_file_table[FAT32_OPEN_FILE_COUNT] = {0};
+
+// Free cluster held for next growth of recently grown file
+static struct FAT32Reservation reservation_table[FAT32_RESERVATION_COUNT] = {0};
+static uint32_t reservation_clock = 0;
+
+// Background flusher, timer tick since last pass and amount of pass metadata has been dirty
+static uint32_t flusher_tick = 0;
+static uint32_t flusher_metadata_age = 0;
+
 /**
  * Convert cluster number to logical block address
  *
@@ -99,7 +121,7 @@ static struct FAT32DriverState driver_state = {0};
  */
 uint32_t cluster_to_lba(uint32_t cluster)
 {
-    return cluster * CLUSTER_BLOCK_COUNT;
+    return driver_state.data_lba + (cluster - ROOT_CLUSTER_NUMBER) * CLUSTER_BLOCK_COUNT;
 }
 
 /**
@@ -124,20 +146,17 @@ void init_directory_table(struct FAT32DirectoryTable *dir_table, char *name, uin
 
 uint32_t move_to_child_directory(struct FAT32DriverRequest request)
 {
-    struct FAT32DirectoryTable directory;
-    read_clusters(&directory, request.parent_cluster_number, 1);
-    int dir_length = sizeof(struct FAT32DirectoryTable) / sizeof(struct FAT32DirectoryEntry);
-    for (int i = 1; i < dir_length; i++)
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, request.parent_cluster_number))
     {
-        struct FAT32DirectoryEntry current_child = directory.table[i];
-        bool current_entry_name_equal = memcmp(current_child.name, request.name, 8) == 0;
-        bool current_entry_ext_equal = memcmp(current_child.ext, "dir", 3) == 0;
-        if (current_entry_ext_equal && current_entry_name_equal)
-        {
-            return current_child.cluster_high << 16 | current_child.cluster_low;
-        }
+        return 0;
     }
-    return 0;
+    struct FAT32DirectoryEntry *current_child = dir_iterator_lookup(&iterator, request.name, "dir");
+    if (current_child == NULL)
+    {
+        return 0;
+    }
+    return current_child->cluster_high << 16 | current_child->cluster_low;
 }
 
 uint32_t move_to_parent_directory(struct FAT32DriverRequest request)
@@ -148,272 +167,1913 @@ uint32_t move_to_parent_directory(struct FAT32DriverRequest request)
     ;
 }
 
-// Helper function to check if two directory requests represent the same directory
-bool is_same_directory(struct FAT32DriverRequest req1, struct FAT32DriverRequest req2)
+bool is_empty_storage(void)
 {
-    return (req1.parent_cluster_number == req2.parent_cluster_number) &&
-           (memcmp(req1.name, req2.name, sizeof(req1.name)) == 0) &&
-           (memcmp(req1.ext, req2.ext, sizeof(req1.ext)) == 0);
+    struct BlockBuffer boot_sector;
+    read_blocks(&boot_sector, BOOT_SECTOR, 1);
+    return memcmp(&boot_sector, fs_signature, BLOCK_SIZE);
 }
 
-// Helper function to find the directory entry index in a directory table
-int32_t find_entry_index(struct FAT32DirectoryTable *dir_table, char *name, char *ext) {
-    for (int i = 0; i < CLUSTER_SIZE / sizeof(struct FAT32DirectoryEntry); i++) {
-        if (memcmp(dir_table->table[i].name, name, 8) == 0 &&
-            memcmp(dir_table->table[i].ext, ext, 3) == 0 &&
-            dir_table->table[i].user_attribute == UATTR_NOT_EMPTY) {
-            return i;
-        }
-    }
-    return -1;
-}
+/**
+ * Set mounted volume geometry, FAT take as many whole cluster as needed for cluster_count entries.
+ * Single-cluster FAT geometry (CLUSTER_MAP_SIZE) place cluster n at block n * CLUSTER_BLOCK_COUNT
+ *
+ * @param cluster_count       FAT entry count
+ * @param journal_block_count Journal region size placed right after FAT, multiple of CLUSTER_BLOCK_COUNT
+ */
+static void fat32_set_geometry(uint32_t cluster_count, uint32_t journal_block_count)
+{
+    uint32_t fat_block_count = (cluster_count + FAT32_FAT_ENTRY_PER_SECTOR - 1) / FAT32_FAT_ENTRY_PER_SECTOR;
+    fat_block_count = (fat_block_count + CLUSTER_BLOCK_COUNT - 1) / CLUSTER_BLOCK_COUNT * CLUSTER_BLOCK_COUNT;
 
-// Helper function to find an empty slot in the directory table
-int32_t find_empty_entry_index(struct FAT32DirectoryTable *dir_table) {
-    struct FAT32DirectoryEntry empty_entry;
-    memset(&empty_entry, 0, sizeof(struct FAT32DirectoryEntry));
-    for (int i = 0; i < CLUSTER_SIZE / sizeof(struct FAT32DirectoryEntry); i++) {
-        if (memcmp(&dir_table->table[i], &empty_entry, sizeof(struct FAT32DirectoryEntry)) == 0) {
-            return i;
-        }
-    }
-    return -1;
+    driver_state.cluster_count   = cluster_count;
+    driver_state.fat_block_count = fat_block_count;
+    driver_state.data_lba        = FAT32_FAT_LBA + fat_block_count + journal_block_count;
 }
 
-uint32_t move_dir(struct FAT32DriverRequest src_req, struct FAT32DriverRequest dest_req) {
-    struct FAT32DirectoryTable src_dir_table;
-    struct FAT32DirectoryTable dest_dir_table;
-    int32_t src_entry_index, dest_entry_index;
-
-    // Check if the source and destination directories are the same
-    if (is_same_directory(src_req, dest_req)) {
-        return 4;  // Source and destination directories are the same
+/**
+ * Largest FAT entry count whose FAT and data cluster fit into disk
+ *
+ * @param block_count Disk capacity in block, 0 if unknown
+ * @return            Cluster count, CLUSTER_MAP_SIZE if capacity is unknown
+ */
+static uint32_t fat32_cluster_count_for(uint32_t block_count)
+{
+    if (block_count <= FAT32_FAT_LBA)
+    {
+        return CLUSTER_MAP_SIZE;
     }
 
-    // Read source directory table
-    src_req.buf = &src_dir_table;
-    src_req.buffer_size = sizeof(struct FAT32DirectoryTable);
+    // Every FAT cluster map entry_per_cluster data cluster, so split cluster after FAT32_FAT_LBA with that ratio
+    uint32_t entry_per_cluster = FAT32_FAT_ENTRY_PER_SECTOR * CLUSTER_BLOCK_COUNT;
+    uint32_t available = (block_count - FAT32_FAT_LBA) / CLUSTER_BLOCK_COUNT;
+    uint32_t cluster_count = available + ROOT_CLUSTER_NUMBER - (available + ROOT_CLUSTER_NUMBER) / (entry_per_cluster + 1);
+    if (cluster_count > FAT32_MAX_CLUSTER_COUNT)
+    {
+        cluster_count = FAT32_MAX_CLUSTER_COUNT;
+    }
+    while (cluster_count - ROOT_CLUSTER_NUMBER + (cluster_count + entry_per_cluster - 1) / entry_per_cluster > available)
+    {
+        cluster_count--;
+    }
+    return cluster_count;
+}
 
+/**
+ * Drop every FAT sector in memory without writing, called when volume is mounted or created
+ */
+static void fat32_reset_fat_cache(void)
+{
+    for (uint32_t i = 0; i < FAT32_FAT_CACHE_SIZE; i++)
+    {
+        driver_state.fat_cache[i].valid = false;
+        driver_state.fat_cache[i].dirty = false;
+    }
+    driver_state.fat_cache_clock = 0;
+}
 
-    // Find the entry to be moved in the source directory table
-    src_entry_index = find_entry_index(&src_dir_table, src_req.name, src_req.ext);
-    if (src_entry_index == -1) {
-        return 1;  // Source entry not found
+// Cluster freed by committed transaction is no longer referenced by any metadata on disk, hand it out again
+static void fat32_release_pending_clusters(void)
+{
+    if (allocator_state.pending_count == 0)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < FAT32_ALLOCATOR_BITMAP_WORD; i++)
+    {
+        allocator_state.used_bitmap[i] &= ~allocator_state.pending_bitmap[i];
+        allocator_state.pending_bitmap[i] = 0;
     }
+    allocator_state.free_count += allocator_state.pending_count;
+    allocator_state.pending_count = 0;
+}
 
-    // Copy the entry to be moved
-    struct FAT32DirectoryEntry entry_to_move = src_dir_table.table[src_entry_index];
+/**
+ * Make running transaction durable. Ordered mode, dirty file content is written before the metadata
+ * pointing to it is committed. Cluster freed by the transaction become allocatable afterward
+ */
+static void fat32_journal_commit(void)
+{
+    bcache_flush();
+    journal_commit();
+    fat32_release_pending_clusters();
+}
 
-    // Read destination directory table
-    dest_req.buf = &dest_dir_table;
-    dest_req.buffer_size = sizeof(struct FAT32DirectoryTable);
-    if (read_directory(dest_req) != 0) {
-        return 2;  // Failed to read destination directory
+/**
+ * Add metadata blocks into running transaction, committing it first if it is full
+ *
+ * @param ptr         Newest content of the blocks
+ * @param lba         Home location of first block
+ * @param block_count Amount of consecutive block, at most JOURNAL_TRANSACTION_MAX
+ */
+static void fat32_journal_log(const void *ptr, uint32_t lba, uint32_t block_count)
+{
+    while (!journal_log_blocks(lba, ptr, block_count))
+    {
+        fat32_journal_commit();
     }
+}
 
-    // Find an empty slot in the destination directory table
-    dest_entry_index = find_empty_entry_index(&dest_dir_table);
-    if (dest_entry_index == -1) {
-        return 3;  // Destination directory is full
+/**
+ * Check whether journal hold newer content than disk for any cluster in range
+ *
+ * @param cluster_number First cluster number
+ * @param cluster_count  Cluster count
+ * @return               True if any cluster is logged, always false without journal
+ */
+static bool fat32_journal_overlap(uint32_t cluster_number, uint32_t cluster_count)
+{
+    if (!journal_enabled())
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < cluster_count; i++)
+    {
+        if (journal_contains(cluster_to_lba(cluster_number + i)))
+        {
+            return true;
+        }
     }
+    return false;
+}
 
-    // Add the entry to the destination directory table
-    dest_dir_table.table[dest_entry_index] = entry_to_move;
+static void fat32_write_fat_sector(struct FAT32FatCacheEntry *entry)
+{
+    if (journal_enabled())
+    {
+        fat32_journal_log(&entry->data, FAT32_FAT_LBA + entry->sector, 1);
+    }
+    else
+    {
+        enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_FAT);
+        write_blocks(&entry->data, FAT32_FAT_LBA + entry->sector, 1);
+        iostat_set_class(previous);
+    }
+    entry->dirty = false;
+}
 
-    // Clear the entry from the source directory table
-    memset(&src_dir_table.table[src_entry_index], 0, sizeof(struct FAT32DirectoryEntry));
+/**
+ * Get cached FAT sector containing entry of cluster_number, least recently used sector is evicted on miss
+ *
+ * @param cluster_number Cluster number
+ * @return               Cache entry holding the sector
+ */
+static struct FAT32FatCacheEntry *fat32_fat_sector(uint32_t cluster_number)
+{
+    uint32_t sector = cluster_number / FAT32_FAT_ENTRY_PER_SECTOR;
+    struct FAT32FatCacheEntry *victim = &driver_state.fat_cache[0];
+    driver_state.fat_cache_clock++;
+    for (uint32_t i = 0; i < FAT32_FAT_CACHE_SIZE; i++)
+    {
+        struct FAT32FatCacheEntry *entry = &driver_state.fat_cache[i];
+        if (entry->valid && entry->sector == sector)
+        {
+            entry->last_used = driver_state.fat_cache_clock;
+            return entry;
+        }
+        if (victim->valid && (!entry->valid || entry->last_used < victim->last_used))
+        {
+            victim = entry;
+        }
+    }
 
-    // Write back the updated source and destination directory tables
-    write_clusters(&src_dir_table, src_req.parent_cluster_number, 1);
-    write_clusters(&dest_dir_table, dest_req.parent_cluster_number, 1);
+    // Victim buffer is reused right after this, so dirty content is dispatched even inside plugged section
+    if (victim->valid && victim->dirty)
+    {
+        fat32_write_fat_sector(victim);
+        disk_dispatch();
+    }
 
-    return 0;  // Success
+    // Sector logged but not yet checkpointed is newer than its home location
+    if (!journal_read_blocks(&victim->data, FAT32_FAT_LBA + sector, 1))
+    {
+        enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_FAT);
+        read_blocks(&victim->data, FAT32_FAT_LBA + sector, 1);
+        iostat_set_class(previous);
+    }
+    victim->sector    = sector;
+    victim->last_used = driver_state.fat_cache_clock;
+    victim->valid     = true;
+    victim->dirty     = false;
+    return victim;
 }
 
-bool is_empty_storage(void)
+/**
+ * Build free cluster bitmap and free count with one full FAT scan, called after volume is mounted.
+ * FAT is streamed through cluster_buf without going into FAT sector cache. Afterward allocator is maintained by fat_set()
+ */
+static void rebuild_cluster_allocator(void)
 {
-    struct BlockBuffer boot_sector;
-    read_blocks(&boot_sector, BOOT_SECTOR, 1);
-    return memcmp(&boot_sector, fs_signature, BLOCK_SIZE);
+    memset(&allocator_state, 0, sizeof(struct FAT32ClusterAllocator));
+    allocator_state.next_hint = FAT32_ALLOCATOR_FIRST_CLUSTER;
+
+    enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_FAT);
+    struct FAT32FileAllocationTableSector *fat_sector = (struct FAT32FileAllocationTableSector *)&driver_state.cluster_buf;
+    uint32_t entry_per_cluster = CLUSTER_SIZE / sizeof(uint32_t);
+    for (uint32_t first = 0; first < driver_state.cluster_count; first += entry_per_cluster)
+    {
+        read_blocks(&driver_state.cluster_buf, FAT32_FAT_LBA + first / FAT32_FAT_ENTRY_PER_SECTOR, CLUSTER_BLOCK_COUNT);
+        for (uint32_t i = first; i < first + entry_per_cluster && i < driver_state.cluster_count; i++)
+        {
+            uint32_t j = i - first;
+            if (fat_sector[j / FAT32_FAT_ENTRY_PER_SECTOR].cluster_map[j % FAT32_FAT_ENTRY_PER_SECTOR] != FAT32_FAT_EMPTY_ENTRY)
+            {
+                allocator_state.used_bitmap[i / 32] |= 1u << (i % 32);
+            }
+            else if (i >= FAT32_ALLOCATOR_FIRST_CLUSTER)
+            {
+                allocator_state.free_count++;
+            }
+        }
+    }
+    iostat_set_class(previous);
 }
 
 /**
- * Create new FAT32 file system. Will write fs_signature into boot sector and
- * proper FileAllocationTable (contain CLUSTER_0_VALUE, CLUSTER_1_VALUE,
- * and initialized root directory) into cluster number 1
+ * Create new FAT32 file system sized from disk_block_count(). Will write fs_signature into boot sector,
+ * FAT32InfoSector and proper FileAllocationTable (contain CLUSTER_0_VALUE, CLUSTER_1_VALUE,
+ * and initialized root directory) starting from cluster number 1
  */
 void create_fat32(void)
 {
+    struct FAT32DirectoryTable root_dir_table = {0};
+    struct FAT32InfoSector info_sector = {0};
+    uint32_t block_count = disk_block_count();
+    uint32_t journal_block_count = block_count >= FAT32_JOURNAL_MIN_DISK_BLOCK ? FAT32_JOURNAL_BLOCK_COUNT : 0;
+    fat32_set_geometry(fat32_cluster_count_for(block_count - journal_block_count), journal_block_count);
+    memcpy(info_sector.signature, FAT32_INFO_SIGNATURE, 8);
+    info_sector.cluster_count       = driver_state.cluster_count;
+    info_sector.fat_block_count     = driver_state.fat_block_count;
+    info_sector.data_lba            = driver_state.data_lba;
+    info_sector.journal_lba         = FAT32_FAT_LBA + driver_state.fat_block_count;
+    info_sector.journal_block_count = journal_block_count;
+
+    // Initial metadata go straight into home location, journal is enabled once volume is complete
+    journal_format(0, 0);
+
+    disk_plug();
     write_blocks(fs_signature, BOOT_SECTOR, 1);
+    write_blocks(&info_sector, FAT32_INFO_SECTOR, 1);
 
-    driver_state.fat_table.cluster_map[0] = CLUSTER_0_VALUE;
-    driver_state.fat_table.cluster_map[1] = CLUSTER_1_VALUE;
-    driver_state.fat_table.cluster_map[ROOT_CLUSTER_NUMBER] = FAT32_FAT_END_OF_FILE;
-
-    for (uint16_t i = 3; i < CLUSTER_MAP_SIZE; i++)
+    // Clear whole FAT on disk, every cluster is free
+    enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_FAT);
+    memset(&driver_state.cluster_buf, 0, CLUSTER_SIZE);
+    for (uint32_t i = 0; i < driver_state.fat_block_count; i += CLUSTER_BLOCK_COUNT)
     {
-        driver_state.fat_table.cluster_map[i] = FAT32_FAT_EMPTY_ENTRY;
+        write_blocks(&driver_state.cluster_buf, FAT32_FAT_LBA + i, CLUSTER_BLOCK_COUNT);
     }
+    iostat_set_class(previous);
 
-    write_clusters(&driver_state.fat_table, FAT_CLUSTER_NUMBER, 1);
+    fat32_reset_fat_cache();
+    memset(&allocator_state, 0, sizeof(struct FAT32ClusterAllocator));
+    allocator_state.free_count = driver_state.cluster_count;
+    allocator_state.next_hint  = FAT32_ALLOCATOR_FIRST_CLUSTER;
+
+    fat_set(0, CLUSTER_0_VALUE);
+    fat_set(1, CLUSTER_1_VALUE);
+    fat_set(ROOT_CLUSTER_NUMBER, FAT32_FAT_END_OF_FILE);
+    flush_fat();
 
-    struct FAT32DirectoryTable root_dir_table = {0};
     init_directory_table(&root_dir_table, "root", ROOT_CLUSTER_NUMBER);
     write_clusters(&root_dir_table, ROOT_CLUSTER_NUMBER, 1);
+    disk_unplug();
+
+    journal_format(info_sector.journal_lba, info_sector.journal_block_count);
 }
 
 /**
  * Initialize file system driver state, if is_empty_storage() then create_fat32()
- * Else, read and cache entire FileAllocationTable (located at cluster number 1) into driver state
+ * Else, read volume geometry and build cluster allocator from FileAllocationTable.
+ * FAT sector is loaded into driver state on demand
  */
 void initialize_filesystem_fat32(void)
 {
+    initialize_buffer_cache();
+    initialize_directory_index();
+    initialize_dentry_cache();
+    initialize_extent_cache();
+    memset(&file_readahead, 0, sizeof(struct FAT32Readahead));
+    memset(open_file_table, 0, sizeof(open_file_table));
+    memset(reservation_table, 0, sizeof(reservation_table));
+    reservation_clock = 0;
+    flusher_tick = 0;
+    flusher_metadata_age = 0;
     if (is_empty_storage())
     {
         create_fat32();
     }
     else
     {
-        read_clusters(&driver_state.fat_table, FAT_CLUSTER_NUMBER, 1);
+        struct FAT32InfoSector info_sector;
+        read_blocks(&info_sector, FAT32_INFO_SECTOR, 1);
+        if (!memcmp(info_sector.signature, FAT32_INFO_SIGNATURE, 8))
+        {
+            driver_state.cluster_count   = info_sector.cluster_count;
+            driver_state.fat_block_count = info_sector.fat_block_count;
+            driver_state.data_lba        = info_sector.data_lba;
+
+            // Committed transaction of last session is replayed before FAT is scanned
+            journal_mount(info_sector.journal_lba, info_sector.journal_block_count);
+        }
+        else
+        {
+            fat32_set_geometry(CLUSTER_MAP_SIZE, 0);
+            journal_mount(0, 0);
+        }
+        fat32_reset_fat_cache();
+        rebuild_cluster_allocator();
+    }
+}
+
+/**
+ * Flush every dirty cluster in buffer cache and dirty FAT sector into disk
+ */
+void sync_filesystem_fat32(void)
+{
+    disk_plug();
+    bcache_flush();
+    flush_fat();
+    disk_unplug();
+    if (journal_enabled())
+    {
+        fat32_journal_commit();
+    }
+}
+
+void fat32_flush_tick(void)
+{
+    if (bcache_get_policy() != BCACHE_WRITE_BACK || ++flusher_tick < FAT32_FLUSH_INTERVAL)
+    {
+        return;
+    }
+    flusher_tick = 0;
+
+    bool metadata_dirty = journal_running_count() > 0;
+    for (uint32_t i = 0; i < FAT32_FAT_CACHE_SIZE && !metadata_dirty; i++)
+    {
+        metadata_dirty = driver_state.fat_cache[i].valid && driver_state.fat_cache[i].dirty;
+    }
+    flusher_metadata_age = metadata_dirty ? flusher_metadata_age + 1 : 0;
+
+    // Old metadata is written after every cluster it may point to. Cluster freed by running transaction
+    // is not reused before commit, so written cluster never hold content committed metadata still reference
+    if (flusher_metadata_age >= BCACHE_WRITEBACK_EXPIRE)
+    {
+        sync_filesystem_fat32();
+        flusher_metadata_age = 0;
+    }
+    else
+    {
+        bcache_writeback();
+    }
+}
+
+uint32_t fat_cluster_count(void)
+{
+    return driver_state.cluster_count;
+}
+
+uint32_t fat_get(uint32_t cluster_number)
+{
+    return fat32_fat_sector(cluster_number)->data.cluster_map[cluster_number % FAT32_FAT_ENTRY_PER_SECTOR];
+}
+
+void fat_set(uint32_t cluster_number, uint32_t value)
+{
+    struct FAT32FatCacheEntry *sector = fat32_fat_sector(cluster_number);
+    uint32_t index = cluster_number % FAT32_FAT_ENTRY_PER_SECTOR;
+    if (sector->data.cluster_map[index] == value)
+    {
+        return;
+    }
+    bool was_free = sector->data.cluster_map[index] == FAT32_FAT_EMPTY_ENTRY;
+    sector->data.cluster_map[index] = value;
+    sector->dirty = true;
+
+    // Keep allocator in sync on every free <-> used transition
+    uint32_t bit = 1u << (cluster_number % 32);
+    if (was_free && (allocator_state.pending_bitmap[cluster_number / 32] & bit))
+    {
+        allocator_state.pending_bitmap[cluster_number / 32] &= ~bit;
+        allocator_state.pending_count--;
+    }
+    else if (was_free)
+    {
+        allocator_state.used_bitmap[cluster_number / 32] |= bit;
+        allocator_state.free_count--;
+    }
+    else if (value == FAT32_FAT_EMPTY_ENTRY && journal_enabled())
+    {
+        // Freeing transaction may still be lost on crash, cluster stay used until it is committed
+        allocator_state.pending_bitmap[cluster_number / 32] |= bit;
+        allocator_state.pending_count++;
+    }
+    else if (value == FAT32_FAT_EMPTY_ENTRY)
+    {
+        allocator_state.used_bitmap[cluster_number / 32] &= ~bit;
+        allocator_state.free_count++;
+    }
+}
+
+/**
+ * Find free run in allocator bitmap without allocating it
+ *
+ * @param cluster_count Wanted run length
+ * @param length        Pointer for storing found run length, at most cluster_count. 0 if file system is full
+ * @return              First cluster number of the run
+ */
+static uint32_t fat32_find_free_run(uint32_t cluster_count, uint32_t *length)
+{
+    *length = 0;
+    if (cluster_count == 0 || allocator_state.free_count == 0)
+    {
+        return 0;
+    }
+
+    // Next-fit, search from hint to end of FAT then wrap around. Stop at first free run long enough,
+    // otherwise take the longest run seen. Fully used word is skipped at once
+    uint32_t best_start = 0, best_length = 0;
+    uint32_t run_start = 0, run_length = 0;
+    uint32_t cluster_number = allocator_state.next_hint;
+    uint32_t scanned = 0;
+    while (scanned < driver_state.cluster_count - FAT32_ALLOCATOR_FIRST_CLUSTER && best_length < cluster_count)
+    {
+        if (cluster_number >= driver_state.cluster_count)
+        {
+            cluster_number = FAT32_ALLOCATOR_FIRST_CLUSTER;
+            run_length = 0;
+        }
+
+        uint32_t word = allocator_state.used_bitmap[cluster_number / 32];
+        if (word == 0xFFFFFFFF)
+        {
+            uint32_t step = 32 - cluster_number % 32;
+            scanned += step;
+            cluster_number += step;
+            run_length = 0;
+            continue;
+        }
+
+        if (word & (1u << (cluster_number % 32)))
+        {
+            run_length = 0;
+        }
+        else
+        {
+            if (run_length == 0)
+            {
+                run_start = cluster_number;
+            }
+            run_length++;
+            if (run_length > best_length)
+            {
+                best_start = run_start;
+                best_length = run_length;
+            }
+        }
+        scanned++;
+        cluster_number++;
+    }
+
+    if (best_length > cluster_count)
+    {
+        best_length = cluster_count;
+    }
+    *length = best_length;
+    return best_start;
+}
+
+uint32_t fat_allocate_extent(uint32_t cluster_count, uint32_t *allocated_count)
+{
+    uint32_t start = fat32_find_free_run(cluster_count, allocated_count);
+    for (uint32_t i = 0; i < *allocated_count; i++)
+    {
+        fat_set(start + i, i == *allocated_count - 1 ? FAT32_FAT_END_OF_FILE : start + i + 1);
+    }
+    if (*allocated_count > 0)
+    {
+        allocator_state.next_hint = start + *allocated_count;
+    }
+    return start;
+}
+
+uint32_t fat_allocate_cluster(void)
+{
+    uint32_t allocated_count;
+    return fat_allocate_extent(1, &allocated_count);
+}
+
+uint32_t fat_free_cluster_count(void)
+{
+    return allocator_state.free_count + allocator_state.reserved_count + allocator_state.pending_count;
+}
+
+/* -- Cluster reservation -- */
+
+/**
+ * Move cluster run between free pool and reservation, FAT is untouched
+ *
+ * @param start    First cluster of the run
+ * @param count    Run length
+ * @param reserved True to reserve free run, false to give reserved run back
+ */
+static void fat32_mark_reserved(uint32_t start, uint32_t count, bool reserved)
+{
+    for (uint32_t cluster_number = start; cluster_number < start + count; cluster_number++)
+    {
+        uint32_t bit = 1u << (cluster_number % 32);
+        if (reserved)
+        {
+            allocator_state.used_bitmap[cluster_number / 32] |= bit;
+        }
+        else
+        {
+            allocator_state.used_bitmap[cluster_number / 32] &= ~bit;
+        }
+    }
+    if (reserved)
+    {
+        allocator_state.free_count     -= count;
+        allocator_state.reserved_count += count;
+    }
+    else
+    {
+        allocator_state.free_count     += count;
+        allocator_state.reserved_count -= count;
+    }
+}
+
+static void fat32_release_reservation(struct FAT32Reservation *reservation)
+{
+    fat32_mark_reserved(reservation->start, reservation->count, false);
+    memset(reservation, 0, sizeof(struct FAT32Reservation));
+}
+
+// Drop reservation of file whose chain is freed or cut
+static void fat32_release_file_reservation(uint32_t first_cluster)
+{
+    for (uint8_t i = 0; i < FAT32_RESERVATION_COUNT; i++)
+    {
+        if (reservation_table[i].first_cluster == first_cluster)
+        {
+            fat32_release_reservation(&reservation_table[i]);
+        }
+    }
+}
+
+/**
+ * Check whether cluster_count cluster can be allocated, every reservation is given back when free cluster run out
+ * and running journal transaction is committed when cluster it freed is needed
+ *
+ * @param cluster_count Amount of cluster about to be allocated
+ * @return              True if there is enough free cluster
+ */
+static bool fat32_has_free_clusters(uint32_t cluster_count)
+{
+    if (allocator_state.free_count < cluster_count)
+    {
+        for (uint8_t i = 0; i < FAT32_RESERVATION_COUNT; i++)
+        {
+            if (reservation_table[i].first_cluster != 0)
+            {
+                fat32_release_reservation(&reservation_table[i]);
+            }
+        }
     }
+    if (allocator_state.free_count < cluster_count && allocator_state.pending_count > 0)
+    {
+        fat32_journal_commit();
+    }
+    return allocator_state.free_count >= cluster_count;
 }
 
 /**
- * Write cluster operation, wrapper for write_blocks().
- * Recommended to use struct ClusterBuffer
+ * Get reservation record of file, least recently grown file lose its record if there is no unused one
+ *
+ * @param first_cluster First cluster of the file
+ * @return              Reservation record, count is 0 if file hold no reservation
+ */
+static struct FAT32Reservation *fat32_file_reservation(uint32_t first_cluster)
+{
+    struct FAT32Reservation *victim = &reservation_table[0];
+    for (uint8_t i = 0; i < FAT32_RESERVATION_COUNT; i++)
+    {
+        struct FAT32Reservation *reservation = &reservation_table[i];
+        if (reservation->first_cluster == first_cluster)
+        {
+            victim = reservation;
+            break;
+        }
+        if (victim->first_cluster != 0 && (reservation->first_cluster == 0 || reservation->last_used < victim->last_used))
+        {
+            victim = reservation;
+        }
+    }
+
+    if (victim->first_cluster != first_cluster)
+    {
+        fat32_release_reservation(victim);
+        victim->first_cluster = first_cluster;
+    }
+    victim->last_used = ++reservation_clock;
+    return victim;
+}
+
+/**
+ * Reserve up to FAT32_RESERVATION_WINDOW free cluster for next growth of file,
+ * right after its last cluster if free, else the next free run
+ *
+ * @param reservation  Empty reservation record of the file
+ * @param last_cluster Current last cluster of the file
+ */
+static void fat32_reserve_window(struct FAT32Reservation *reservation, uint32_t last_cluster)
+{
+    uint32_t start = last_cluster + 1;
+    uint32_t count = 0;
+    while (count < FAT32_RESERVATION_WINDOW && start + count < driver_state.cluster_count &&
+           !(allocator_state.used_bitmap[(start + count) / 32] & (1u << ((start + count) % 32))))
+    {
+        count++;
+    }
+    if (count == 0)
+    {
+        start = fat32_find_free_run(FAT32_RESERVATION_WINDOW, &count);
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    fat32_mark_reserved(start, count, true);
+    reservation->start = start;
+    reservation->count = count;
+    if (allocator_state.next_hint >= start && allocator_state.next_hint < start + count)
+    {
+        allocator_state.next_hint = start + count;
+    }
+}
+
+void flush_fat(void)
+{
+    for (uint32_t i = 0; i < FAT32_FAT_CACHE_SIZE; i++)
+    {
+        if (driver_state.fat_cache[i].valid && driver_state.fat_cache[i].dirty)
+        {
+            fat32_write_fat_sector(&driver_state.fat_cache[i]);
+        }
+    }
+}
+
+/**
+ * Called at the end of metadata operation. FAT is written immediately in BCACHE_WRITE_THROUGH,
+ * in BCACHE_WRITE_BACK dirty sectors of many operation is batched until sync_filesystem_fat32().
+ * On journaled volume, every operation end with its FAT sector in running transaction.
+ * BCACHE_WRITE_THROUGH commit it right away, BCACHE_WRITE_BACK group many operation into one commit
+ */
+static void commit_fat(void)
+{
+    if (journal_enabled())
+    {
+        flush_fat();
+        if (bcache_get_policy() == BCACHE_WRITE_THROUGH || journal_running_count() >= JOURNAL_GROUP_COMMIT)
+        {
+            fat32_journal_commit();
+        }
+    }
+    else if (bcache_get_policy() == BCACHE_WRITE_THROUGH)
+    {
+        flush_fat();
+    }
+}
+
+/**
+ * Caller class of cluster I/O for block statistics. FAT bypass cluster I/O, cluster other than file content is directory table
+ *
+ * @return IOSTAT_CLASS_DATA if file content is being transferred, else IOSTAT_CLASS_DIRECTORY
+ */
+static enum IOStatClass fat32_io_class(void)
+{
+    if (iostat_get_class() == IOSTAT_CLASS_DATA)
+        return IOSTAT_CLASS_DATA;
+    return IOSTAT_CLASS_DIRECTORY;
+}
+
+/**
+ * Write cluster operation, go through buffer cache into write_blocks().
+ * On journaled volume, directory cluster go into buffer cache and running transaction instead.
+ * Recommended to use struct ClusterBuffer
+ *
+ * @param ptr            Pointer to source data
+ * @param cluster_number Cluster number to write
+ * @param cluster_count  Cluster count to write
+ */
+void write_clusters(const void *ptr, uint32_t cluster_number, uint32_t cluster_count)
+{
+    enum IOStatClass io_class = fat32_io_class();
+    if (journal_enabled() && io_class == IOSTAT_CLASS_DIRECTORY)
+    {
+        bcache_store(ptr, cluster_number, cluster_count);
+        for (uint32_t i = 0; i < cluster_count; i++)
+        {
+            fat32_journal_log((const uint8_t *)ptr + i * CLUSTER_SIZE, cluster_to_lba(cluster_number + i), CLUSTER_BLOCK_COUNT);
+        }
+        return;
+    }
+
+    // Directory cluster freed and reused as file content, its logged copy must not be checkpointed over the new content
+    if (fat32_journal_overlap(cluster_number, cluster_count))
+    {
+        fat32_journal_commit();
+        journal_checkpoint();
+    }
+
+    enum IOStatClass previous = iostat_set_class(io_class);
+    bcache_write(ptr, cluster_number, cluster_count);
+    iostat_set_class(previous);
+}
+
+/**
+ * Read cluster operation, served from buffer cache or read_blocks().
+ * Recommended to use struct ClusterBuffer
+ *
+ * @param ptr            Pointer to buffer for reading
+ * @param cluster_number Cluster number to read
+ * @param cluster_count  Cluster count to read
+ */
+void read_clusters(void *ptr, uint32_t cluster_number, uint32_t cluster_count)
+{
+    enum IOStatClass previous = iostat_set_class(fat32_io_class());
+    if (fat32_journal_overlap(cluster_number, cluster_count))
+    {
+        // Logged cluster evicted from buffer cache is served from journal, its home location is older
+        for (uint32_t i = 0; i < cluster_count; i++)
+        {
+            uint8_t *buf = (uint8_t *)ptr + i * CLUSTER_SIZE;
+            if (!journal_read_blocks(buf, cluster_to_lba(cluster_number + i), CLUSTER_BLOCK_COUNT))
+            {
+                bcache_read(buf, cluster_number + i, 1);
+            }
+        }
+    }
+    else
+    {
+        bcache_read(ptr, cluster_number, cluster_count);
+    }
+    iostat_set_class(previous);
+}
+
+/* -- CRUD Operation -- */
+
+/**
+ *  FAT32 Folder / Directory read
+ *
+ * @param request buf point to struct FAT32DirectoryTable,
+ *                name is directory name,
+ *                ext is unused,
+ *                parent_cluster_number is target directory table to read,
+ *                buffer_size must be exactly sizeof(struct FAT32DirectoryTable)
+ * @return Error code: 0 success - 1 not a folder - 2 not found - -1 unknown
+ */
+int8_t read_directory(struct FAT32DriverRequest request)
+{
+    // Check if parent directory is a folder
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, request.parent_cluster_number))
+    {
+        return -1;
+    }
+
+    struct FAT32DirectoryEntry *entry = dir_iterator_lookup(&iterator, request.name, request.ext);
+    if (entry == NULL)
+    {
+        return 2;
+    }
+
+    // Check if is a directory
+    if (entry->attribute != ATTR_SUBDIRECTORY)
+    {
+        return 1;
+    }
+
+    // Read first cluster of directory table
+    uint32_t cluster_number = entry->cluster_low | (entry->cluster_high << 16);
+    read_clusters(&driver_state.dir_table_buf, cluster_number, 1);
+    return 0;
+}
+
+/**
+ * Length of contiguous run in cluster chain, where every cluster link to the next cluster number
+ *
+ * @param cluster_number First cluster of the run
+ * @param limit          Maximum run length to check
+ * @return               Amount of cluster that can be transferred with one read_clusters() / write_clusters()
+ */
+static uint32_t fat32_contiguous_run(uint32_t cluster_number, uint32_t limit)
+{
+    uint32_t run = 1;
+    while (run < limit && fat_get(cluster_number + run - 1) == cluster_number + run)
+    {
+        run++;
+    }
+    return run;
+}
+
+/**
+ * Readahead before reading cluster of a chain walk. Window grow on sequential hop and reset otherwise.
+ * On cache miss, contiguous run starting from cluster_number in FAT (up to window) is prefetched with one request
+ *
+ * @param readahead      Readahead state of the walk
+ * @param cluster_number Cluster about to be read
+ */
+static void fat32_readahead(struct FAT32Readahead *readahead, uint32_t cluster_number)
+{
+    if (cluster_number == readahead->last_cluster)
+        return;
+    readahead->last_cluster = cluster_number;
+
+    if (cluster_number == readahead->expected_cluster)
+    {
+        readahead->window *= 2;
+        if (readahead->window > FAT32_READAHEAD_MAX_WINDOW)
+            readahead->window = FAT32_READAHEAD_MAX_WINDOW;
+    }
+    else
+    {
+        readahead->window = FAT32_READAHEAD_MIN_WINDOW;
+    }
+    readahead->expected_cluster = fat_get(cluster_number);
+
+    if (bcache_contains(cluster_number))
+        return;
+
+    // Prefetched home location of logged cluster would be stale in cache
+    uint32_t run = fat32_contiguous_run(cluster_number, readahead->window);
+    if (run > 1 && !fat32_journal_overlap(cluster_number, run))
+        bcache_prefetch(cluster_number, run);
+}
+
+/* -- Directory iterator -- */
+
+bool dir_iterator_open(struct FAT32DirectoryIterator *iterator, uint32_t dir_cluster_number)
+{
+    read_clusters(&iterator->table, dir_cluster_number, 1);
+    iterator->cluster_number = dir_cluster_number;
+    iterator->entry_index = 1;
+    iterator->readahead.expected_cluster = fat_get(dir_cluster_number);
+    iterator->readahead.window = FAT32_READAHEAD_MIN_WINDOW / 2;
+    iterator->readahead.last_cluster = dir_cluster_number;
+    return iterator->table.table[0].attribute == ATTR_SUBDIRECTORY;
+}
+
+struct FAT32DirectoryEntry *dir_iterator_next_slot(struct FAT32DirectoryIterator *iterator)
+{
+    if (iterator->entry_index == FAT32_DIRECTORY_ENTRY_COUNT)
+    {
+        uint32_t next_cluster = fat_get(iterator->cluster_number);
+        if (next_cluster == FAT32_FAT_END_OF_FILE)
+        {
+            return NULL;
+        }
+        fat32_readahead(&iterator->readahead, next_cluster);
+        read_clusters(&iterator->table, next_cluster, 1);
+        iterator->cluster_number = next_cluster;
+        iterator->entry_index = 0;
+    }
+    return &iterator->table.table[iterator->entry_index++];
+}
+
+struct FAT32DirectoryEntry *dir_iterator_next(struct FAT32DirectoryIterator *iterator)
+{
+    struct FAT32DirectoryEntry *entry;
+    while ((entry = dir_iterator_next_slot(iterator)) != NULL)
+    {
+        if (entry->user_attribute == UATTR_NOT_EMPTY)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+struct FAT32DirectoryEntry *dir_iterator_find(struct FAT32DirectoryIterator *iterator, const char *name, const char *ext)
+{
+    struct FAT32DirectoryEntry *entry;
+    while ((entry = dir_iterator_next(iterator)) != NULL)
+    {
+        if (!memcmp(entry->name, name, 8) && !memcmp(entry->ext, ext, 3))
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/* -- Directory index -- */
+
+/**
+ * Get index of directory, on first touch whole directory is walked once to build it
+ *
+ * @param iterator Iterator freshly opened at the directory, exhausted if index is built
+ * @return         Index record, NULL if directory is too large to be indexed
+ */
+static struct DirectoryIndex *fat32_directory_index(struct FAT32DirectoryIterator *iterator)
+{
+    uint32_t dir_cluster = iterator->cluster_number;
+    struct DirectoryIndex *directory = dirindex_get(dir_cluster);
+    if (directory != NULL)
+    {
+        return directory;
+    }
+
+    directory = dirindex_create(dir_cluster);
+    struct FAT32DirectoryEntry *slot;
+    while ((slot = dir_iterator_next_slot(iterator)) != NULL)
+    {
+        if (slot->user_attribute != UATTR_NOT_EMPTY)
+        {
+            if (directory->free_slot_count++ == 0)
+            {
+                directory->free_slot_cluster = iterator->cluster_number;
+            }
+        }
+        else if (!dirindex_insert(directory, slot, iterator->cluster_number, iterator->entry_index - 1))
+        {
+            dirindex_drop(dir_cluster);
+            return NULL;
+        }
+    }
+    directory->last_cluster = iterator->cluster_number;
+    return directory;
+}
+
+struct FAT32DirectoryEntry *dir_iterator_lookup(struct FAT32DirectoryIterator *iterator, const char *name, const char *ext)
+{
+    uint32_t dir_cluster = iterator->cluster_number;
+    struct DirectoryIndex *directory = fat32_directory_index(iterator);
+    if (directory == NULL)
+    {
+        // Directory is too large to be indexed, fallback into linear walk
+        dir_iterator_open(iterator, dir_cluster);
+        return dir_iterator_find(iterator, name, ext);
+    }
+
+    struct DirectoryIndexNode *node = dirindex_lookup(directory, name, ext);
+    if (node == NULL)
+    {
+        return NULL;
+    }
+    if (iterator->cluster_number != node->slot_cluster)
+    {
+        read_clusters(&iterator->table, node->slot_cluster, 1);
+        iterator->cluster_number = node->slot_cluster;
+    }
+    iterator->entry_index = node->slot_index + 1;
+    return &iterator->table.table[node->slot_index];
+}
+
+/**
+ * Find free slot for new entry, starting from directory index free slot hint when available.
+ * Found slot cluster is loaded into driver_state.dir_table_buf
+ *
+ * @param dir_cluster  First cluster of directory
+ * @param directory    Index of directory, NULL to search whole directory
+ * @param slot_cluster Pointer for storing directory cluster of free slot
+ * @param slot_index   Pointer for storing slot index inside slot_cluster
+ * @param last_cluster Pointer for storing last cluster of directory, set if directory is full
+ * @return             False if directory is full
+ */
+static bool fat32_find_free_slot(uint32_t dir_cluster, struct DirectoryIndex *directory, uint32_t *slot_cluster, uint32_t *slot_index, uint32_t *last_cluster)
+{
+    uint32_t start_cluster = dir_cluster;
+    if (directory != NULL)
+    {
+        if (directory->free_slot_count == 0)
+        {
+            *last_cluster = directory->last_cluster;
+            return false;
+        }
+        start_cluster = directory->free_slot_cluster;
+    }
+
+    // Search from hint until end of chain, then once more from first cluster if hint is stale
+    for (uint32_t cluster_number = start_cluster; cluster_number != FAT32_FAT_END_OF_FILE;)
+    {
+        read_clusters(&driver_state.dir_table_buf, cluster_number, 1);
+        for (uint32_t i = cluster_number == dir_cluster ? 1 : 0; i < FAT32_DIRECTORY_ENTRY_COUNT; i++)
+        {
+            if (driver_state.dir_table_buf.table[i].user_attribute != UATTR_NOT_EMPTY)
+            {
+                *slot_cluster = cluster_number;
+                *slot_index = i;
+                return true;
+            }
+        }
+
+        uint32_t next_cluster = fat_get(cluster_number);
+        if (next_cluster == FAT32_FAT_END_OF_FILE)
+        {
+            *last_cluster = cluster_number;
+            if (start_cluster != dir_cluster)
+            {
+                next_cluster = start_cluster = dir_cluster;
+            }
+        }
+        cluster_number = next_cluster;
+    }
+    return false;
+}
+
+/**
+ * FAT32 read, read a file from file system.
+ *
+ * @param request All attribute will be used for read, buffer_size will limit reading count
+ * @return Error code: 0 success - 1 not a file - 2 not enough buffer - 3 not found - -1 unknown
+ */
+int8_t read(struct FAT32DriverRequest request)
+{
+    // Check if parent directory is a folder
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, request.parent_cluster_number))
+    {
+        return -1;
+    }
+
+    struct FAT32DirectoryEntry *entry = dir_iterator_lookup(&iterator, request.name, request.ext);
+    if (entry == NULL)
+    {
+        return 3;
+    }
+
+    // Check if is a file
+    bool is_file = entry->attribute != ATTR_SUBDIRECTORY;
+    if (!is_file)
+    {
+        return 1;
+    }
+
+    // Check if buffer size is enough
+    bool is_buffer_enough = request.buffer_size >= entry->filesize;
+    if (!is_buffer_enough)
+    {
+        return 2;
+    }
+
+    // Read file content, every contiguous run of the chain is read with one request
+    uint32_t cluster_number = entry->cluster_low | (entry->cluster_high << 16);
+    uint32_t offset = 0;
+    enum IOStatClass previous_class = iostat_set_class(IOSTAT_CLASS_DATA);
+
+    do
+    {
+        uint32_t run = fat32_contiguous_run(cluster_number, driver_state.cluster_count);
+        read_clusters(request.buf + offset * CLUSTER_SIZE, cluster_number, run);
+        cluster_number = fat_get(cluster_number + run - 1);
+        offset += run;
+    } while (cluster_number != FAT32_FAT_END_OF_FILE);
+    iostat_set_class(previous_class);
+
+    return 0;
+}
+
+int32_t ceil_div(int32_t a, int32_t b)
+{
+    return a / b + (a % b != 0);
+}
+
+/* -- Positional file access -- */
+
+/**
+ * Walk cluster chain to cluster containing the given cluster index of the file
+ *
+ * @param cluster_number First cluster of the file
+ * @param cluster_index  Cluster index inside the file, 0 is first cluster
+ * @return               Cluster number, FAT32_FAT_END_OF_FILE if chain is shorter
+ */
+static uint32_t fat32_seek_cluster(uint32_t cluster_number, uint32_t cluster_index)
+{
+    while (cluster_index > 0 && cluster_number != FAT32_FAT_END_OF_FILE)
+    {
+        cluster_number = fat_get(cluster_number);
+        cluster_index--;
+    }
+    return cluster_number;
+}
+
+/**
+ * Walk to cluster at the given cluster index of open file. Sequential access continue from cursor with one
+ * FAT lookup per cluster boundary, other access is mapped through extent cache. Cursor is moved to result
+ *
+ * @param file          Open file
+ * @param cursor        Known position on the chain of file
+ * @param cluster_index Cluster index inside the file, 0 is first cluster
+ * @return              Cluster number, FAT32_FAT_END_OF_FILE if chain is shorter
+ */
+static uint32_t fat32_cursor_seek(const struct FAT32OpenFile *file, struct FAT32FileCursor *cursor, uint32_t cluster_index)
+{
+    uint32_t cluster_number;
+    if (cursor->cluster_number != 0 && cursor->generation == file->generation &&
+        cursor->cluster_index <= cluster_index && cluster_index - cursor->cluster_index <= 1)
+    {
+        cluster_number = fat32_seek_cluster(cursor->cluster_number, cluster_index - cursor->cluster_index);
+    }
+    else
+    {
+        // Any other jump is a binary search over the cached run of the chain
+        cluster_number = extcache_map(file->first_cluster, cluster_index);
+    }
+
+    if (cluster_number != FAT32_FAT_END_OF_FILE)
+    {
+        cursor->cluster_index  = cluster_index;
+        cursor->cluster_number = cluster_number;
+        cursor->generation     = file->generation;
+    }
+    return cluster_number;
+}
+
+/**
+ * Append cluster into end of chain, taken from reservation of the file first and then allocated
+ * as few contiguous extent as possible. Reservation is refilled once used up
+ *
+ * @param first_cluster First cluster of the chain, owner of reservation
+ * @param last_cluster  Current last cluster of the chain
+ * @param cluster_count Amount of cluster to append, caller must check with fat32_has_free_clusters()
+ */
+static void fat32_extend_chain(uint32_t first_cluster, uint32_t last_cluster, uint32_t cluster_count)
+{
+    struct FAT32Reservation *reservation = fat32_file_reservation(first_cluster);
+    while (cluster_count > 0)
+    {
+        uint32_t run;
+        uint32_t cluster_number;
+        if (reservation->count > 0)
+        {
+            // Reserved run go back into free pool and is allocated right away as regular chain
+            run = cluster_count < reservation->count ? cluster_count : reservation->count;
+            cluster_number = reservation->start;
+            fat32_mark_reserved(cluster_number, run, false);
+            for (uint32_t i = 0; i < run; i++)
+            {
+                fat_set(cluster_number + i, i == run - 1 ? FAT32_FAT_END_OF_FILE : cluster_number + i + 1);
+            }
+            reservation->start += run;
+            reservation->count -= run;
+        }
+        else
+        {
+            cluster_number = fat_allocate_extent(cluster_count, &run);
+        }
+        fat_set(last_cluster, cluster_number);
+        last_cluster = cluster_number + run - 1;
+        cluster_count -= run;
+    }
+
+    if (reservation->count == 0)
+    {
+        fat32_reserve_window(reservation, last_cluster);
+    }
+}
+
+/**
+ * Write byte range into cluster chain of open file, chain must already cover the range.
+ * Whole cluster is written directly from src, partial cluster is read, modified and written back
+ *
+ * @param file     Open file
+ * @param cursor   Cursor of the walk, left at last written cluster
+ * @param position Byte offset inside the file
+ * @param src      Source data, NULL to fill the range with zero
+ * @param length   Byte count to write
+ */
+static void fat32_write_chain(const struct FAT32OpenFile *file, struct FAT32FileCursor *cursor, uint32_t position, const uint8_t *src, uint32_t length)
+{
+    uint32_t cluster_number = fat32_cursor_seek(file, cursor, position / CLUSTER_SIZE);
+    while (length > 0 && cluster_number != FAT32_FAT_END_OF_FILE)
+    {
+        uint32_t cluster_offset = position % CLUSTER_SIZE;
+        uint32_t last_cluster = cluster_number;
+        uint32_t chunk;
+        if (src != NULL && cluster_offset == 0 && length >= CLUSTER_SIZE)
+        {
+            uint32_t run = fat32_contiguous_run(cluster_number, length / CLUSTER_SIZE);
+            write_clusters(src, cluster_number, run);
+            last_cluster = cluster_number + run - 1;
+            chunk = run * CLUSTER_SIZE;
+        }
+        else
+        {
+            chunk = CLUSTER_SIZE - cluster_offset < length ? CLUSTER_SIZE - cluster_offset : length;
+            if (chunk < CLUSTER_SIZE)
+            {
+                read_clusters(&driver_state.cluster_buf, cluster_number, 1);
+            }
+            if (src != NULL)
+            {
+                memcpy(driver_state.cluster_buf.buf + cluster_offset, src, chunk);
+            }
+            else
+            {
+                memset(driver_state.cluster_buf.buf + cluster_offset, 0, chunk);
+            }
+            write_clusters(&driver_state.cluster_buf, cluster_number, 1);
+
+            // cluster_buf is reused by next partial cluster, pending write of it must reach the disk first
+            disk_dispatch();
+        }
+
+        if (src != NULL)
+        {
+            src += chunk;
+        }
+        position += chunk;
+        length -= chunk;
+        cursor->cluster_index  = (position - 1) / CLUSTER_SIZE;
+        cursor->cluster_number = last_cluster;
+        if (length > 0)
+        {
+            cluster_number = fat_get(last_cluster);
+        }
+    }
+}
+
+/**
+ * Read byte range of open file. Whole cluster is read directly into dst, partial cluster is copied out of cluster_buf
+ *
+ * @param file   Open file
+ * @param cursor Cursor of the walk, left at last read cluster
+ * @param offset Byte offset where read start
+ * @param dst    Destination buffer
+ * @param length Byte count to read
+ * @return       Byte count read, less than length near end of file
+ */
+static uint32_t fat32_file_read_at(const struct FAT32OpenFile *file, struct FAT32FileCursor *cursor, uint32_t offset, uint8_t *dst, uint32_t length)
+{
+    if (offset >= file->filesize)
+    {
+        return 0;
+    }
+    if (file->filesize - offset < length)
+    {
+        length = file->filesize - offset;
+    }
+
+    uint32_t position = offset;
+    uint32_t remaining = length;
+    uint32_t cluster_number = fat32_cursor_seek(file, cursor, position / CLUSTER_SIZE);
+    enum IOStatClass previous_class = iostat_set_class(IOSTAT_CLASS_DATA);
+    while (remaining > 0 && cluster_number != FAT32_FAT_END_OF_FILE)
+    {
+        uint32_t cluster_offset = position % CLUSTER_SIZE;
+        uint32_t last_cluster = cluster_number;
+        uint32_t chunk;
+        if (cluster_offset == 0 && remaining >= CLUSTER_SIZE)
+        {
+            uint32_t run = fat32_contiguous_run(cluster_number, remaining / CLUSTER_SIZE);
+            read_clusters(dst, cluster_number, run);
+            last_cluster = cluster_number + run - 1;
+            chunk = run * CLUSTER_SIZE;
+        }
+        else
+        {
+            // Small sequential read hit the same cluster many times, readahead only on cluster change
+            fat32_readahead(&file_readahead, cluster_number);
+            read_clusters(&driver_state.cluster_buf, cluster_number, 1);
+            chunk = CLUSTER_SIZE - cluster_offset < remaining ? CLUSTER_SIZE - cluster_offset : remaining;
+            memcpy(dst, driver_state.cluster_buf.buf + cluster_offset, chunk);
+        }
+
+        dst += chunk;
+        position += chunk;
+        remaining -= chunk;
+        cursor->cluster_index  = (position - 1) / CLUSTER_SIZE;
+        cursor->cluster_number = last_cluster;
+        if (remaining > 0)
+        {
+            cluster_number = fat_get(last_cluster);
+        }
+    }
+    iostat_set_class(previous_class);
+
+    return length - remaining;
+}
+
+/**
+ * Write into open file in place, only cluster covering the written range, the FAT entries of grown or
+ * truncated tail and the directory entry on size change are written
+ *
+ * @param file     Open file, filesize is updated
+ * @param cursor   Cursor of the walk, left at last written cluster
+ * @param offset   Byte offset where write start
+ * @param src      Source data
+ * @param length   Byte count to write
+ * @param truncate File end right after written range, cluster past new end is freed
+ * @return Error code: 0 success - 2 not enough space - -1 unknown
+ */
+static int8_t fat32_file_write_at(struct FAT32OpenFile *file, struct FAT32FileCursor *cursor, uint32_t offset, const uint8_t *src, uint32_t length, bool truncate)
+{
+    uint32_t end = offset + length;
+    if (end < offset)
+    {
+        return -1;
+    }
+
+    // Check if amount of cluster is enough for growing the file, file always keep its first cluster
+    uint32_t filesize = file->filesize;
+    uint32_t new_filesize = truncate || end > filesize ? end : filesize;
+    uint32_t cluster_count = ceil_div(filesize, CLUSTER_SIZE);
+    uint32_t new_cluster_count = ceil_div(new_filesize, CLUSTER_SIZE);
+    cluster_count = cluster_count == 0 ? 1 : cluster_count;
+    new_cluster_count = new_cluster_count == 0 ? 1 : new_cluster_count;
+    if (new_cluster_count > cluster_count && !fat32_has_free_clusters(new_cluster_count - cluster_count))
+    {
+        return 2;
+    }
+
+    // Every write below is held and dispatched sorted & merged, directory entry is written on size change
+    disk_plug();
+    if (new_cluster_count > cluster_count)
+    {
+        fat32_extend_chain(file->first_cluster, fat32_cursor_seek(file, cursor, cluster_count - 1), new_cluster_count - cluster_count);
+        extcache_grow(file->first_cluster);
+    }
+    else if (new_cluster_count < cluster_count)
+    {
+        uint32_t last_cluster = fat32_cursor_seek(file, cursor, new_cluster_count - 1);
+        uint32_t cluster_number = fat_get(last_cluster);
+        fat32_release_file_reservation(file->first_cluster);
+        fat_set(last_cluster, FAT32_FAT_END_OF_FILE);
+        while (cluster_number != FAT32_FAT_END_OF_FILE)
+        {
+            uint32_t next_cluster = fat_get(cluster_number);
+            fat_set(cluster_number, FAT32_FAT_EMPTY_ENTRY);
+            bcache_discard(cluster_number, 1);
+            cluster_number = next_cluster;
+        }
+
+        // Other cursor may point into freed tail, this cursor is still before the new end
+        extcache_invalidate(file->first_cluster);
+        file->generation++;
+        cursor->generation = file->generation;
+    }
+
+    enum IOStatClass previous_class = iostat_set_class(IOSTAT_CLASS_DATA);
+    if (offset > filesize)
+    {
+        fat32_write_chain(file, cursor, filesize, NULL, offset - filesize);
+    }
+    fat32_write_chain(file, cursor, offset, src, length);
+    iostat_set_class(previous_class);
+
+    if (new_filesize != filesize)
+    {
+        // Entry location is known, slot is updated without searching the directory
+        file->filesize = new_filesize;
+        read_clusters(&driver_state.dir_table_buf, file->entry_cluster, 1);
+        driver_state.dir_table_buf.table[file->entry_index].filesize = new_filesize;
+        write_clusters(&driver_state.dir_table_buf, file->entry_cluster, 1);
+    }
+    commit_fat();
+    disk_unplug();
+
+    return 0;
+}
+
+// Open file table record of directory slot, NULL if file is not open
+static struct FAT32OpenFile *fat32_open_file_at(uint32_t entry_cluster, uint32_t entry_index)
+{
+    for (uint8_t i = 0; i < FAT32_OPEN_FILE_COUNT; i++)
+    {
+        struct FAT32OpenFile *file = &open_file_table[i];
+        if (file->reference_count > 0 && file->entry_cluster == entry_cluster && file->entry_index == entry_index)
+        {
+            return file;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Locate file by name. Record in open file table is used when the file is open, so every
+ * descriptor see size change and truncation done by name, otherwise file is described in scratch
+ *
+ * @param request Locate the file, buf and buffer_size is unused
+ * @param scratch Record filled when file is not open
+ * @param file    Pointer for storing the record to use
+ * @return Error code: 0 success - 1 not a file - 3 not found - -1 unknown
+ */
+static int8_t fat32_lookup_file(struct FAT32DriverRequest request, struct FAT32OpenFile *scratch, struct FAT32OpenFile **file)
+{
+    // Check if parent directory is a folder
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, request.parent_cluster_number))
+    {
+        return -1;
+    }
+
+    struct FAT32DirectoryEntry *entry = dir_iterator_lookup(&iterator, request.name, request.ext);
+    if (entry == NULL)
+    {
+        return 3;
+    }
+    if (entry->attribute == ATTR_SUBDIRECTORY)
+    {
+        return 1;
+    }
+
+    uint32_t entry_index = entry - iterator.table.table;
+    *file = fat32_open_file_at(iterator.cluster_number, entry_index);
+    if (*file == NULL)
+    {
+        memset(scratch, 0, sizeof(struct FAT32OpenFile));
+        scratch->entry_cluster = iterator.cluster_number;
+        scratch->entry_index   = entry_index;
+        scratch->first_cluster = entry->cluster_low | (entry->cluster_high << 16);
+        scratch->filesize      = entry->filesize;
+        *file = scratch;
+    }
+    return 0;
+}
+
+int8_t pread(struct FAT32DriverRequest request, struct FAT32FileRange *range)
+{
+    range->transferred = 0;
+
+    struct FAT32OpenFile scratch;
+    struct FAT32OpenFile *file;
+    int8_t retcode = fat32_lookup_file(request, &scratch, &file);
+    if (retcode != 0)
+    {
+        return retcode;
+    }
+
+    struct FAT32FileCursor cursor = {0};
+    range->transferred = fat32_file_read_at(file, &cursor, range->offset, request.buf, request.buffer_size);
+    return 0;
+}
+
+/**
+ * Write into existing file located by name
+ *
+ * @param request  buf is source, buffer_size is byte count to write, other attribute locate the file
+ * @param offset   Byte offset where write start, ignored if at_end
+ * @param at_end   Write start at current end of file
+ * @param truncate File end right after written range, cluster past new end is freed
+ * @return Error code: 0 success - 1 not a file - 2 not enough space - 3 not found - -1 unknown
+ */
+static int8_t fat32_write_in_place(struct FAT32DriverRequest request, uint32_t offset, bool at_end, bool truncate)
+{
+    struct FAT32OpenFile scratch;
+    struct FAT32OpenFile *file;
+    int8_t retcode = fat32_lookup_file(request, &scratch, &file);
+    if (retcode != 0)
+    {
+        return retcode;
+    }
+
+    struct FAT32FileCursor cursor = {0};
+    return fat32_file_write_at(file, &cursor, at_end ? file->filesize : offset, request.buf, request.buffer_size, truncate);
+}
+
+int8_t pwrite(struct FAT32DriverRequest request, struct FAT32FileRange *range)
+{
+    range->transferred = 0;
+    int8_t retcode = fat32_write_in_place(request, range->offset, false, false);
+    if (retcode == 0)
+    {
+        range->transferred = request.buffer_size;
+    }
+    return retcode;
+}
+
+int8_t append(struct FAT32DriverRequest request)
+{
+    return fat32_write_in_place(request, 0, true, false);
+}
+
+int8_t overwrite(struct FAT32DriverRequest request)
+{
+    return fat32_write_in_place(request, 0, false, true);
+}
+
+/* -- Open file table -- */
+
+// Descriptor that hold a live record, NULL if descriptor is closed or its file was deleted
+static struct FAT32OpenFile *fat32_descriptor_file(const struct FAT32FileDescriptor *descriptor)
+{
+    if (!descriptor->used || descriptor->open_file < 0 || descriptor->open_file >= FAT32_OPEN_FILE_COUNT)
+    {
+        return NULL;
+    }
+    struct FAT32OpenFile *file = &open_file_table[descriptor->open_file];
+    return file->entry_cluster != 0 ? file : NULL;
+}
+
+int8_t file_open(struct FAT32DriverRequest request, struct FAT32FileDescriptor *descriptor)
+{
+    struct FAT32OpenFile scratch;
+    struct FAT32OpenFile *file;
+    int8_t retcode = fat32_lookup_file(request, &scratch, &file);
+    if (retcode != 0)
+    {
+        return retcode;
+    }
+
+    if (file == &scratch)
+    {
+        file = NULL;
+        for (uint8_t i = 0; i < FAT32_OPEN_FILE_COUNT && file == NULL; i++)
+        {
+            if (open_file_table[i].reference_count == 0)
+            {
+                file = &open_file_table[i];
+            }
+        }
+        if (file == NULL)
+        {
+            return 4;
+        }
+        *file = scratch;
+    }
+
+    file->reference_count++;
+    memset(descriptor, 0, sizeof(struct FAT32FileDescriptor));
+    descriptor->used      = true;
+    descriptor->open_file = file - open_file_table;
+    return 0;
+}
+
+int8_t file_read(struct FAT32FileDescriptor *descriptor, void *buf, uint32_t count, uint32_t *transferred)
+{
+    *transferred = 0;
+    struct FAT32OpenFile *file = fat32_descriptor_file(descriptor);
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    *transferred = fat32_file_read_at(file, &descriptor->cursor, descriptor->offset, buf, count);
+    descriptor->offset += *transferred;
+    return 0;
+}
+
+int8_t file_write(struct FAT32FileDescriptor *descriptor, const void *buf, uint32_t count, uint32_t *transferred)
+{
+    *transferred = 0;
+    struct FAT32OpenFile *file = fat32_descriptor_file(descriptor);
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    int8_t retcode = fat32_file_write_at(file, &descriptor->cursor, descriptor->offset, buf, count, false);
+    if (retcode == 0)
+    {
+        *transferred = count;
+        descriptor->offset += count;
+    }
+    return retcode;
+}
+
+int8_t file_seek(struct FAT32FileDescriptor *descriptor, int32_t offset, uint8_t whence, uint32_t *position)
+{
+    struct FAT32OpenFile *file = fat32_descriptor_file(descriptor);
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    int64_t base;
+    switch (whence)
+    {
+    case FAT32_SEEK_SET:
+        base = 0;
+        break;
+    case FAT32_SEEK_CUR:
+        base = descriptor->offset;
+        break;
+    case FAT32_SEEK_END:
+        base = file->filesize;
+        break;
+    default:
+        return -1;
+    }
+    if (base + offset < 0 || base + offset > UINT32_MAX)
+    {
+        return -1;
+    }
+
+    // Cursor is kept, next access walk forward from it or restart from first cluster when seeking backward
+    descriptor->offset = base + offset;
+    *position = descriptor->offset;
+    return 0;
+}
+
+int8_t file_close(struct FAT32FileDescriptor *descriptor)
+{
+    if (!descriptor->used || descriptor->open_file < 0 || descriptor->open_file >= FAT32_OPEN_FILE_COUNT)
+    {
+        return -1;
+    }
+
+    struct FAT32OpenFile *file = &open_file_table[descriptor->open_file];
+    if (file->reference_count > 0 && --file->reference_count == 0)
+    {
+        memset(file, 0, sizeof(struct FAT32OpenFile));
+    }
+    memset(descriptor, 0, sizeof(struct FAT32FileDescriptor));
+    return 0;
+}
+
+int8_t file_sync(struct FAT32FileDescriptor *descriptor)
+{
+    if (fat32_descriptor_file(descriptor) == NULL)
+    {
+        return -1;
+    }
+    sync_filesystem_fat32();
+    return 0;
+}
+
+/**
+ * Check whether text file contain pattern. File is paged with pread() through fixed size chunk,
+ * each chunk keep the tail of previous chunk so match across chunk boundary is found.
+ * Like C string, content end at first null character
+ *
+ * @param request File to scan, buf must hold FAT32_SEARCH_CHUNK_SIZE + 1 byte
+ * @param pattern Null-terminated pattern
+ * @param matcher boyer_moore() or knuth_morris_pratt()
+ * @return        True if pattern is found
+ */
+static bool fat32_file_contains(struct FAT32DriverRequest request, char *pattern, bool (*matcher)(char *, char *))
+{
+    char *text = request.buf;
+    uint32_t overlap = strlen(pattern) > 0 ? strlen(pattern) - 1 : 0;
+    if (overlap > FAT32_SEARCH_CHUNK_SIZE / 2)
+    {
+        overlap = FAT32_SEARCH_CHUNK_SIZE / 2;
+    }
+
+    struct FAT32FileRange range = {0};
+    uint32_t carry = 0;
+    while (true)
+    {
+        request.buf = text + carry;
+        request.buffer_size = FAT32_SEARCH_CHUNK_SIZE - carry;
+        if (pread(request, &range) != 0 || range.transferred == 0)
+        {
+            return false;
+        }
+
+        uint32_t length = carry + range.transferred;
+        text[length] = '\0';
+        if (matcher(pattern, text))
+        {
+            return true;
+        }
+        if ((uint32_t)strlen(text) < length)
+        {
+            return false;
+        }
+
+        range.offset += range.transferred;
+        carry = overlap < length ? overlap : length;
+        memmove(text, text + length - carry, carry);
+    }
+}
+
+/* -- Path resolution -- */
+
+/**
+ * Look up one name through dentry cache, directory is searched only on cache miss
  *
- * @param ptr            Pointer to source data
- * @param cluster_number Cluster number to write
- * @param cluster_count  Cluster count to write, due limitation of write_blocks block_count 255 => max cluster_count = 63
+ * @param parent_cluster_number Directory to search
+ * @param name                  8-byte entry name
+ * @param ext                   3-byte entry extension
+ * @return                      Cached lookup result, NULL if parent is not a folder
  */
-void write_clusters(const void *ptr, uint32_t cluster_number, uint8_t cluster_count)
+static struct DentryCacheEntry *fat32_lookup_dentry(uint32_t parent_cluster_number, const char *name, const char *ext)
 {
-    write_blocks(ptr, cluster_to_lba(cluster_number), cluster_count * CLUSTER_BLOCK_COUNT);
+    struct DentryCacheEntry *dentry = dcache_lookup(parent_cluster_number, name, ext);
+    if (dentry != NULL)
+    {
+        return dentry;
+    }
+
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, parent_cluster_number))
+    {
+        return NULL;
+    }
+    return dcache_insert(parent_cluster_number, name, ext, dir_iterator_lookup(&iterator, name, ext));
 }
 
-/**
- * Read cluster operation, wrapper for read_blocks().
- * Recommended to use struct ClusterBuffer
- *
- * @param ptr            Pointer to buffer for reading
- * @param cluster_number Cluster number to read
- * @param cluster_count  Cluster count to read, due limitation of read_blocks block_count 255 => max cluster_count = 63
- */
-void read_clusters(void *ptr, uint32_t cluster_number, uint8_t cluster_count)
+// Parent of directory is stored in slot 0 of its first cluster
+static uint32_t fat32_parent_directory(uint32_t dir_cluster_number)
 {
-    read_blocks(ptr, cluster_to_lba(cluster_number), cluster_count * CLUSTER_BLOCK_COUNT);
+    read_clusters(&driver_state.dir_table_buf, dir_cluster_number, 1);
+    struct FAT32DirectoryEntry *self = &driver_state.dir_table_buf.table[0];
+    return self->cluster_high << 16 | self->cluster_low;
 }
 
-/* -- CRUD Operation -- */
-
-/**
- *  FAT32 Folder / Directory read
- *
- * @param request buf point to struct FAT32DirectoryTable,
- *                name is directory name,
- *                ext is unused,
- *                parent_cluster_number is target directory table to read,
- *                buffer_size must be exactly sizeof(struct FAT32DirectoryTable)
- * @return Error code: 0 success - 1 not a folder - 2 not found - -1 unknown
- */
-int8_t read_directory(struct FAT32DriverRequest request)
+int8_t resolve_path(struct FAT32PathRequest request, struct FAT32ResolvedPath *result)
 {
-    read_clusters(&driver_state.dir_table_buf, request.parent_cluster_number, 1);
+    const char *path = request.path;
+    uint32_t dir_cluster_number = *path == '/' ? ROOT_CLUSTER_NUMBER : request.cwd_cluster_number;
+    memset(result, 0, sizeof(struct FAT32ResolvedPath));
 
-    // Check if parent directory is a folder
-    if (driver_state.dir_table_buf.table[0].attribute != ATTR_SUBDIRECTORY)
+    while (true)
     {
-        return -1;
-    }
+        // Take next component, repeated or trailing separator is ignored
+        while (*path == '/')
+        {
+            path++;
+        }
+        if (*path == '\0')
+        {
+            break;
+        }
+        const char *component = path;
+        uint32_t length = 0;
+        while (path[length] != '\0' && path[length] != '/')
+        {
+            length++;
+        }
+        path += length;
 
-    // Loop over entries in directory table
-    uint32_t directory_size = sizeof(struct FAT32DirectoryTable) / sizeof(struct FAT32DirectoryEntry);
-    for (uint32_t i = 0; i < directory_size; i++)
-    {
-        // Check if name and extension is match
-        bool is_name_match = !memcmp(driver_state.dir_table_buf.table[i].name, request.name, 8);
-        bool is_ext_match = !memcmp(driver_state.dir_table_buf.table[i].ext, request.ext, 3);
+        if (length == 1 && component[0] == '.')
+        {
+            continue;
+        }
+        if (length == 2 && component[0] == '.' && component[1] == '.')
+        {
+            dir_cluster_number = fat32_parent_directory(dir_cluster_number);
+            continue;
+        }
+
+        // Split name and extension at first dot
+        uint32_t name_length = 0;
+        while (name_length < length && component[name_length] != '.')
+        {
+            name_length++;
+        }
+        uint32_t ext_length = name_length < length ? length - name_length - 1 : 0;
+        if (name_length == 0 || name_length > 8 || ext_length > 3)
+        {
+            return -1;
+        }
+        char name[8] = {0};
+        char ext[3] = {0};
+        memcpy(name, component, name_length);
+        memcpy(ext, component + name_length + 1, ext_length);
+        bool has_ext = name_length < length;
+
+        const char *rest = path;
+        while (*rest == '/')
+        {
+            rest++;
+        }
+        bool is_last = *rest == '\0';
 
-        if (is_name_match && is_ext_match)
+        // Component without extension is a folder, or on last component a file without extension
+        struct DentryCacheEntry *dentry = fat32_lookup_dentry(dir_cluster_number, name, has_ext ? ext : "dir");
+        if (dentry == NULL)
+        {
+            return 2;
+        }
+        if (!is_last)
         {
-            // Check if is a directory
-            bool is_directory = driver_state.dir_table_buf.table[i].attribute == ATTR_SUBDIRECTORY;
-            if (!is_directory)
+            if (dentry->negative || dentry->attribute != ATTR_SUBDIRECTORY)
             {
-                return 1;
+                return 2;
             }
+            dir_cluster_number = dentry->cluster_number;
+            continue;
+        }
 
-            // Read directory table
-            uint32_t cluster_number = driver_state.dir_table_buf.table[i].cluster_low | (driver_state.dir_table_buf.table[i].cluster_high << 16);
-            read_clusters(&driver_state.dir_table_buf, cluster_number, 1);
-            return 0;
+        if (dentry->negative && !has_ext)
+        {
+            dentry = fat32_lookup_dentry(dir_cluster_number, name, ext);
+        }
+        else if (!has_ext)
+        {
+            memcpy(ext, "dir", 3);
+        }
+        result->parent_cluster_number = dir_cluster_number;
+        memcpy(result->name, name, 8);
+        memcpy(result->ext, ext, 3);
+        if (dentry->negative)
+        {
+            return 1;
         }
+        result->cluster_number = dentry->cluster_number;
+        result->is_directory = dentry->attribute == ATTR_SUBDIRECTORY;
+        return 0;
     }
 
-    return 2;
+    // Path end with directory itself, such as "/", "." or "..". Name is stored in its slot 0
+    result->parent_cluster_number = fat32_parent_directory(dir_cluster_number);
+    result->cluster_number = dir_cluster_number;
+    memcpy(result->name, driver_state.dir_table_buf.table[0].name, 8);
+    memcpy(result->ext, "dir", 3);
+    result->is_directory = true;
+    return 0;
 }
 
 /**
- * FAT32 read, read a file from file system.
+ * Store new entry into free slot found by fat32_find_free_slot(), growing full directory with one cluster.
+ * Directory table and FAT are written, directory index and dentry cache learn the new entry. Caller end the operation with commit_fat()
  *
- * @param request All attribute will be used for read, buffer_size will limit reading count
- * @return Error code: 0 success - 1 not a file - 2 not enough buffer - 3 not found - -1 unknown
+ * @param parent_cluster_number First cluster of directory
+ * @param directory             Index of directory, NULL if not indexed
+ * @param new_entry             Entry to store
+ * @param has_free_slot         Result of fat32_find_free_slot(), false if directory is full
+ * @param free_slot_cluster     Directory cluster of free slot, loaded in driver_state.dir_table_buf. Updated if directory grow
+ * @param free_slot_index       Slot index inside free_slot_cluster. Updated if directory grow
+ * @param last_cluster          Last cluster of full directory
+ * @return                      False if full directory cannot grow, nothing is written
  */
-int8_t read(struct FAT32DriverRequest request)
+static bool fat32_insert_entry(uint32_t parent_cluster_number, struct DirectoryIndex *directory, const struct FAT32DirectoryEntry *new_entry,
+                               bool has_free_slot, uint32_t *free_slot_cluster, uint32_t *free_slot_index, uint32_t last_cluster)
 {
-    read_clusters(&driver_state.dir_table_buf, request.parent_cluster_number, 1);
-
-    // Check if parent directory is a folder
-    if (driver_state.dir_table_buf.table[0].attribute != ATTR_SUBDIRECTORY)
+    if (!has_free_slot)
     {
-        return -1;
+        // Directory is full, grow it with new cluster linked after its last cluster
+        if (!fat32_has_free_clusters(1))
+        {
+            return false;
+        }
+        *free_slot_cluster = fat_allocate_cluster();
+        *free_slot_index = 0;
+        fat_set(last_cluster, *free_slot_cluster);
+        memset(&driver_state.dir_table_buf, 0, sizeof(struct FAT32DirectoryTable));
+        if (directory != NULL)
+        {
+            directory->last_cluster = *free_slot_cluster;
+            directory->free_slot_count += FAT32_DIRECTORY_ENTRY_COUNT;
+        }
     }
+    driver_state.dir_table_buf.table[*free_slot_index] = *new_entry;
+    write_clusters(&driver_state.dir_table_buf, *free_slot_cluster, 1);
 
-    // Loop over entries in directory table
-    uint32_t directory_size = sizeof(struct FAT32DirectoryTable) / sizeof(struct FAT32DirectoryEntry);
-    for (uint32_t i = 0; i < directory_size; i++)
+    if (directory != NULL)
     {
-        // Check if name and extension is match
-        bool is_name_match = !memcmp(driver_state.dir_table_buf.table[i].name, request.name, 8);
-        bool is_ext_match = !memcmp(driver_state.dir_table_buf.table[i].ext, request.ext, 3);
+        directory->free_slot_count--;
+        directory->free_slot_cluster = *free_slot_cluster;
+        if (!dirindex_insert(directory, new_entry, *free_slot_cluster, *free_slot_index))
+        {
+            dirindex_drop(parent_cluster_number);
+        }
+    }
+    dcache_insert(parent_cluster_number, new_entry->name, new_entry->ext, new_entry);
+    return true;
+}
 
-        if (is_name_match && is_ext_match)
+/**
+ * Copy content of cluster chain into newly allocated chain, placed in as few contiguous run as possible.
+ * Content move through buffer cache FAT32_COPY_BATCH cluster at a time and never leave the kernel
+ *
+ * @param source_cluster First cluster of source chain
+ * @param cluster_count  Amount of cluster to copy, caller must check with fat32_has_free_clusters()
+ * @return               First cluster of the new chain
+ */
+static uint32_t fat32_copy_chain(uint32_t source_cluster, uint32_t cluster_count)
+{
+    static uint8_t copy_buffer[FAT32_COPY_BATCH * CLUSTER_SIZE];
+    enum IOStatClass previous_class = iostat_set_class(IOSTAT_CLASS_DATA);
+    uint32_t first_cluster = 0;
+    uint32_t previous_cluster = 0;
+    uint32_t i = 0;
+    while (i < cluster_count)
+    {
+        uint32_t run;
+        uint32_t cluster_number = fat_allocate_extent(cluster_count - i, &run);
+        if (i == 0)
         {
-            // Check if is a file
-            bool is_file = driver_state.dir_table_buf.table[i].attribute != ATTR_SUBDIRECTORY;
-            if (!is_file)
-            {
-                return 1;
-            }
+            first_cluster = cluster_number;
+        }
+        else
+        {
+            fat_set(previous_cluster, cluster_number);
+        }
 
-            // Check if buffer size is enough
-            bool is_buffer_enough = request.buffer_size >= driver_state.dir_table_buf.table[i].filesize;
-            if (!is_buffer_enough)
+        // Every batch is read with as few request as source layout allow, then written with one request
+        for (uint32_t done = 0; done < run;)
+        {
+            uint32_t batch = run - done < FAT32_COPY_BATCH ? run - done : FAT32_COPY_BATCH;
+            for (uint32_t filled = 0; filled < batch;)
             {
-                return 2;
+                uint32_t source_run = fat32_contiguous_run(source_cluster, batch - filled);
+                read_clusters(copy_buffer + filled * CLUSTER_SIZE, source_cluster, source_run);
+                source_cluster = fat_get(source_cluster + source_run - 1);
+                filled += source_run;
             }
-
-            // Read file content
-            uint32_t cluster_number = driver_state.dir_table_buf.table[i].cluster_low | (driver_state.dir_table_buf.table[i].cluster_high << 16);
-            uint32_t offset = 0;
-
-            do
-            {
-                read_clusters(request.buf + offset * CLUSTER_SIZE, cluster_number, 1);
-                cluster_number = driver_state.fat_table.cluster_map[cluster_number];
-                offset++;
-            } while (cluster_number != FAT32_FAT_END_OF_FILE);
-
-            return 0;
+            write_clusters(copy_buffer, cluster_number + done, batch);
+            done += batch;
         }
+        previous_cluster = cluster_number + run - 1;
+        i += run;
     }
-
-    return 3;
-}
-
-int32_t ceil_div(int32_t a, int32_t b)
-{
-    return a / b + (a % b != 0);
+    iostat_set_class(previous_class);
+    return first_cluster;
 }
 
 /**
@@ -424,108 +2084,234 @@ int32_t ceil_div(int32_t a, int32_t b)
  */
 int8_t write(struct FAT32DriverRequest request)
 {
-    read_clusters(&driver_state.dir_table_buf, request.parent_cluster_number, 1);
-
     // Check if parent directory is a folder
-    if (driver_state.dir_table_buf.table[0].attribute != ATTR_SUBDIRECTORY)
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, request.parent_cluster_number))
     {
         return -1;
     }
 
-    // Loop over entries in directory table
-    uint32_t directory_size = sizeof(struct FAT32DirectoryTable) / sizeof(struct FAT32DirectoryEntry);
-    for (uint32_t i = 0; i < directory_size; i++)
+    // Reject existing name, then find free slot for the new entry
+    if (dir_iterator_lookup(&iterator, request.name, request.ext) != NULL)
     {
-        // Check if name and extension is match
-        bool is_name_match = !memcmp(driver_state.dir_table_buf.table[i].name, request.name, 8);
-        bool is_ext_match = !memcmp(driver_state.dir_table_buf.table[i].ext, request.ext, 3);
-
-        if (is_name_match && is_ext_match)
-        {
-            return 1;
-        }
+        return 1;
     }
+    struct DirectoryIndex *directory = dirindex_get(request.parent_cluster_number);
+    uint32_t free_slot_cluster = 0;
+    uint32_t free_slot_index = 0;
+    uint32_t last_cluster = 0;
+    bool has_free_slot = fat32_find_free_slot(request.parent_cluster_number, directory, &free_slot_cluster, &free_slot_index, &last_cluster);
 
-    // Check if amount of cluster is enough
+    // Check if amount of cluster is enough, folder always take one cluster and full directory need one more
     uint32_t cluster_count = ceil_div(request.buffer_size, CLUSTER_SIZE);
-    uint32_t cluster_available = 0;
-    for (uint32_t i = 2; i < CLUSTER_MAP_SIZE; i++)
-    {
-        if (driver_state.fat_table.cluster_map[i] == FAT32_FAT_EMPTY_ENTRY)
-        {
-            cluster_available++;
-        }
-    }
-
-    if (cluster_available < cluster_count)
+    uint32_t cluster_needed = (cluster_count == 0 ? 1 : cluster_count) + (has_free_slot ? 0 : 1);
+    if (!fat32_has_free_clusters(cluster_needed))
     {
         return -1;
     }
 
-    uint32_t empty_cluster = 0;
-    for (uint32_t i = 2; i < CLUSTER_MAP_SIZE; i++)
-    {
-        if (driver_state.fat_table.cluster_map[i] == FAT32_FAT_EMPTY_ENTRY)
-        {
-            empty_cluster = i;
-            break;
-        }
-    }
-
     // Write file content
     struct FAT32DirectoryEntry new_entry = {.filesize = request.buffer_size, .user_attribute = UATTR_NOT_EMPTY};
     memcpy(new_entry.name, request.name, 8);
     memcpy(new_entry.ext, request.ext, 3);
-    new_entry.cluster_low = empty_cluster & 0xFFFF;
-    new_entry.cluster_high = (empty_cluster >> 16) & 0xFFFF;
 
+    // Every write below is held and dispatched sorted & merged, new_dir_table must outlive disk_unplug()
+    struct FAT32DirectoryTable new_dir_table = {0};
+    uint32_t first_cluster = 0;
+    disk_plug();
     if (request.buffer_size == 0)
     {
+        first_cluster = fat_allocate_cluster();
         new_entry.attribute = ATTR_SUBDIRECTORY;
-        struct FAT32DirectoryTable new_dir_table = {0};
         init_directory_table(&new_dir_table, request.name, request.parent_cluster_number);
-        driver_state.fat_table.cluster_map[empty_cluster] = FAT32_FAT_END_OF_FILE;
-        write_clusters(&new_dir_table, empty_cluster, 1);
+        write_clusters(&new_dir_table, first_cluster, 1);
     }
     else
     {
-        uint32_t empty_clusters[CLUSTER_MAP_SIZE] = {0};
-        uint32_t idx = 0;
-        for (uint32_t i = 0; i < CLUSTER_MAP_SIZE; i++)
-        {
-            if (driver_state.fat_table.cluster_map[i] == FAT32_FAT_EMPTY_ENTRY)
-            {
-                empty_clusters[idx++] = i;
-            }
-        }
-
-        for (uint32_t i = 0; i < cluster_count; i++)
+        enum IOStatClass previous_class = iostat_set_class(IOSTAT_CLASS_DATA);
+        uint32_t previous_cluster = 0;
+        uint32_t i = 0;
+        while (i < cluster_count)
         {
-            uint32_t cluster_number = empty_clusters[i];
-            if (i == cluster_count - 1)
+            // File is placed in as few contiguous run as possible, each run written with one request
+            uint32_t run;
+            uint32_t cluster_number = fat_allocate_extent(cluster_count - i, &run);
+            if (i == 0)
             {
-                driver_state.fat_table.cluster_map[cluster_number] = FAT32_FAT_END_OF_FILE;
+                first_cluster = cluster_number;
             }
             else
             {
-                driver_state.fat_table.cluster_map[cluster_number] = empty_clusters[i + 1];
+                fat_set(previous_cluster, cluster_number);
             }
-            write_clusters(request.buf + i * CLUSTER_SIZE, cluster_number, 1);
+            write_clusters(request.buf + i * CLUSTER_SIZE, cluster_number, run);
+            previous_cluster = cluster_number + run - 1;
+            i += run;
         }
+        iostat_set_class(previous_class);
+    }
+    new_entry.cluster_low = first_cluster & 0xFFFF;
+    new_entry.cluster_high = (first_cluster >> 16) & 0xFFFF;
+    fat32_insert_entry(request.parent_cluster_number, directory, &new_entry, has_free_slot, &free_slot_cluster, &free_slot_index, last_cluster);
+    commit_fat();
+    disk_unplug();
+
+    return 0;
+}
+
+int8_t copy_file(struct FAT32DriverRequest src_request, struct FAT32DriverRequest dest_request)
+{
+    // Locate source file, its entry is copied before iterator buffer is reused
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, src_request.parent_cluster_number))
+    {
+        return -1;
+    }
+    struct FAT32DirectoryEntry *source = dir_iterator_lookup(&iterator, src_request.name, src_request.ext);
+    if (source == NULL)
+    {
+        return 3;
+    }
+    if (source->attribute == ATTR_SUBDIRECTORY)
+    {
+        return 2;
+    }
+    uint32_t filesize = source->filesize;
+    uint32_t source_cluster = source->cluster_low | (source->cluster_high << 16);
+
+    // Destination is checked the same way as write()
+    if (!dir_iterator_open(&iterator, dest_request.parent_cluster_number))
+    {
+        return -1;
+    }
+    if (dir_iterator_lookup(&iterator, dest_request.name, dest_request.ext) != NULL)
+    {
+        return 1;
+    }
+    struct DirectoryIndex *directory = dirindex_get(dest_request.parent_cluster_number);
+    uint32_t free_slot_cluster = 0;
+    uint32_t free_slot_index = 0;
+    uint32_t last_cluster = 0;
+    bool has_free_slot = fat32_find_free_slot(dest_request.parent_cluster_number, directory, &free_slot_cluster, &free_slot_index, &last_cluster);
+
+    // Empty file still own one cluster
+    uint32_t cluster_count = filesize == 0 ? 1 : ceil_div(filesize, CLUSTER_SIZE);
+    if (!fat32_has_free_clusters(cluster_count + (has_free_slot ? 0 : 1)))
+    {
+        return -1;
+    }
+
+    // Content is copied unplugged, copy buffer is reused by every batch
+    uint32_t first_cluster = fat32_copy_chain(source_cluster, cluster_count);
+
+    struct FAT32DirectoryEntry new_entry = {
+        .filesize = filesize,
+        .user_attribute = UATTR_NOT_EMPTY,
+        .cluster_low = first_cluster & 0xFFFF,
+        .cluster_high = (first_cluster >> 16) & 0xFFFF,
+    };
+    memcpy(new_entry.name, dest_request.name, 8);
+    memcpy(new_entry.ext, dest_request.ext, 3);
+
+    disk_plug();
+    fat32_insert_entry(dest_request.parent_cluster_number, directory, &new_entry, has_free_slot, &free_slot_cluster, &free_slot_index, last_cluster);
+    commit_fat();
+    disk_unplug();
+
+    return 0;
+}
+
+int8_t move_dir(struct FAT32DriverRequest src_request, struct FAT32DriverRequest dest_request)
+{
+    // Locate source entry, slot location is kept for relocating open file record
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, src_request.parent_cluster_number))
+    {
+        return -1;
+    }
+    struct FAT32DirectoryEntry *source = dir_iterator_lookup(&iterator, src_request.name, src_request.ext);
+    if (source == NULL)
+    {
+        return 1;
+    }
+    struct FAT32DirectoryEntry entry = *source;
+    uint32_t source_slot_cluster = iterator.cluster_number;
+    uint32_t source_slot_index = source - iterator.table.table;
+    uint32_t cluster_number = entry.cluster_low | (entry.cluster_high << 16);
+
+    // Folder and file are told apart by "dir" extension, moved entry must keep its kind
+    if ((entry.attribute == ATTR_SUBDIRECTORY) != !memcmp(dest_request.ext, "dir", 3))
+    {
+        return 4;
     }
 
-    uint32_t new_entry_idx = 0;
-    for (uint32_t i = 1; i < directory_size; i++)
+    // Destination name must be free
+    if (!dir_iterator_open(&iterator, dest_request.parent_cluster_number))
     {
-        if (driver_state.dir_table_buf.table[i].user_attribute != UATTR_NOT_EMPTY)
+        return -1;
+    }
+    if (dir_iterator_lookup(&iterator, dest_request.name, dest_request.ext) != NULL)
+    {
+        return 2;
+    }
+
+    // Directory cannot be moved into itself or its own subdirectory
+    if (entry.attribute == ATTR_SUBDIRECTORY)
+    {
+        for (uint32_t ancestor = dest_request.parent_cluster_number; ancestor != ROOT_CLUSTER_NUMBER; ancestor = fat32_parent_directory(ancestor))
         {
-            new_entry_idx = i;
-            break;
+            if (ancestor == cluster_number)
+            {
+                return 3;
+            }
         }
     }
-    driver_state.dir_table_buf.table[new_entry_idx] = new_entry;
-    write_clusters(&driver_state.dir_table_buf, request.parent_cluster_number, 1);
-    write_clusters(&driver_state.fat_table, FAT_CLUSTER_NUMBER, 1);
+
+    // Destination entry is written first, crash before source slot is cleared leave duplicate entry instead of lost file.
+    // Not plugged, every table below is re-read after the previous write. Journaled volume commit everything at once
+    memcpy(entry.name, dest_request.name, 8);
+    memcpy(entry.ext, dest_request.ext, 3);
+    uint32_t free_slot_cluster = 0;
+    uint32_t free_slot_index = 0;
+    uint32_t last_cluster = 0;
+    struct DirectoryIndex *directory = dirindex_get(dest_request.parent_cluster_number);
+    bool has_free_slot = fat32_find_free_slot(dest_request.parent_cluster_number, directory, &free_slot_cluster, &free_slot_index, &last_cluster);
+    if (!fat32_insert_entry(dest_request.parent_cluster_number, directory, &entry, has_free_slot, &free_slot_cluster, &free_slot_index, last_cluster))
+    {
+        return -1;
+    }
+
+    // Moved directory point to its new parent, and know its new name
+    if (entry.attribute == ATTR_SUBDIRECTORY)
+    {
+        read_clusters(&driver_state.dir_table_buf, cluster_number, 1);
+        struct FAT32DirectoryEntry *self = &driver_state.dir_table_buf.table[0];
+        self->cluster_low = dest_request.parent_cluster_number & 0xFFFF;
+        self->cluster_high = (dest_request.parent_cluster_number >> 16) & 0xFFFF;
+        memcpy(self->name, dest_request.name, 8);
+        write_clusters(&driver_state.dir_table_buf, cluster_number, 1);
+    }
+
+    read_clusters(&driver_state.dir_table_buf, source_slot_cluster, 1);
+    memset(&driver_state.dir_table_buf.table[source_slot_index], 0, sizeof(struct FAT32DirectoryEntry));
+    write_clusters(&driver_state.dir_table_buf, source_slot_cluster, 1);
+    struct DirectoryIndex *source_directory = dirindex_get(src_request.parent_cluster_number);
+    if (source_directory != NULL)
+    {
+        dirindex_remove(source_directory, src_request.name, src_request.ext);
+        source_directory->free_slot_count++;
+        source_directory->free_slot_cluster = source_slot_cluster;
+    }
+    dcache_invalidate(src_request.parent_cluster_number, src_request.name, src_request.ext);
+    commit_fat();
+
+    // Descriptor of open file keep working at the new location
+    struct FAT32OpenFile *file = fat32_open_file_at(source_slot_cluster, source_slot_index);
+    if (file != NULL)
+    {
+        file->entry_cluster = free_slot_cluster;
+        file->entry_index = free_slot_index;
+    }
 
     return 0;
 }
@@ -538,74 +2324,88 @@ int8_t write(struct FAT32DriverRequest request)
  */
 int8_t delete(struct FAT32DriverRequest request)
 {
-    read_clusters(&driver_state.dir_table_buf, request.parent_cluster_number, 1);
-
     // Check if parent directory is a folder
-    if (driver_state.dir_table_buf.table[0].attribute != ATTR_SUBDIRECTORY)
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, request.parent_cluster_number))
     {
         return -1;
     }
 
-    // Loop over entries in directory table
-    uint32_t directory_size = sizeof(struct FAT32DirectoryTable) / sizeof(struct FAT32DirectoryEntry);
-    for (uint32_t i = 0; i < directory_size; i++)
+    struct FAT32DirectoryEntry *target = dir_iterator_lookup(&iterator, request.name, request.ext);
+    if (target == NULL)
     {
-        // Check if name and extension is match
-        bool is_name_match = !memcmp(driver_state.dir_table_buf.table[i].name, request.name, 8);
-        bool is_ext_match = !memcmp(driver_state.dir_table_buf.table[i].ext, request.ext, 3);
+        return 1;
+    }
 
-        if (is_name_match && is_ext_match)
+    struct FAT32DirectoryEntry entry = *target;
+    uint32_t cluster_number = entry.cluster_low | (entry.cluster_high << 16);
+    struct FAT32OpenFile *file = fat32_open_file_at(iterator.cluster_number, target - iterator.table.table);
+    if (entry.attribute == ATTR_SUBDIRECTORY)
+    {
+        // Indexed directory know its entry count without reading it
+        struct DirectoryIndex *child_directory = dirindex_get(cluster_number);
+        struct FAT32DirectoryIterator child_iterator;
+        if (child_directory != NULL ? child_directory->node_count != 0
+                                    : (dir_iterator_open(&child_iterator, cluster_number), dir_iterator_next(&child_iterator) != NULL))
         {
-            struct FAT32DirectoryEntry entry = driver_state.dir_table_buf.table[i];
-
-            if (entry.attribute == ATTR_SUBDIRECTORY)
-            {
-                struct FAT32DirectoryTable dir_table;
-                uint32_t cluster_number = entry.cluster_low | (entry.cluster_high << 16);
-                read_clusters(&dir_table, cluster_number, 1);
-
-                for (uint32_t i = 1; i < directory_size; i++)
-                {
-                    if (dir_table.table[i].user_attribute == UATTR_NOT_EMPTY)
-                    {
-                        return 2;
-                    }
-                }
-            }
-
-            // Remove entry
-            driver_state.dir_table_buf.table[i].user_attribute = 0;
-            memset(driver_state.dir_table_buf.table[i].name, 0, 8);
-            memset(driver_state.dir_table_buf.table[i].ext, 0, 3);
+            return 2;
+        }
+        dirindex_drop(cluster_number);
+        dcache_invalidate_directory(cluster_number);
+    }
 
-            // Remove file content
-            uint32_t cluster_number = entry.cluster_low | (entry.cluster_high << 16);
-            do
-            {
-                uint32_t next_cluster = driver_state.fat_table.cluster_map[cluster_number];
-                driver_state.fat_table.cluster_map[cluster_number] = FAT32_FAT_EMPTY_ENTRY;
-                cluster_number = next_cluster;
-            } while (cluster_number != FAT32_FAT_END_OF_FILE);
+    // Descriptor of deleted file fail from now on, record is released by the last file_close()
+    if (file != NULL)
+    {
+        file->entry_cluster = 0;
+    }
 
-            write_clusters(&driver_state.dir_table_buf, request.parent_cluster_number, 1);
-            write_clusters(&driver_state.fat_table, FAT_CLUSTER_NUMBER, 1);
+    // Remove entry
+    target->user_attribute = 0;
+    memset(target->name, 0, 8);
+    memset(target->ext, 0, 3);
 
-            return 0;
-        }
+    // Remove file content, or every cluster of directory
+    extcache_invalidate(cluster_number);
+    // Content not yet written back is dropped, short-lived file never reach disk
+    fat32_release_file_reservation(cluster_number);
+    do
+    {
+        uint32_t next_cluster = fat_get(cluster_number);
+        fat_set(cluster_number, FAT32_FAT_EMPTY_ENTRY);
+        bcache_discard(cluster_number, 1);
+        cluster_number = next_cluster;
+    } while (cluster_number != FAT32_FAT_END_OF_FILE);
+
+    disk_plug();
+    write_clusters(&iterator.table, iterator.cluster_number, 1);
+    commit_fat();
+    disk_unplug();
+
+    struct DirectoryIndex *directory = dirindex_get(request.parent_cluster_number);
+    if (directory != NULL)
+    {
+        dirindex_remove(directory, request.name, request.ext);
+        directory->free_slot_count++;
+        directory->free_slot_cluster = iterator.cluster_number;
     }
+    dcache_invalidate(request.parent_cluster_number, request.name, request.ext);
 
-    return 1;
+    return 0;
 }
 
 void list_dir_content(char *buffer, uint32_t dir_cluster_number)
 {
-    struct FAT32DirectoryTable dirtable;
-    read_clusters(&dirtable, dir_cluster_number, 1);
-    int dir_length = sizeof(struct FAT32DirectoryTable) / sizeof(struct FAT32DirectoryEntry);
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, dir_cluster_number))
+    {
+        return;
+    }
     int idx = 0;
-    for (int i = 1; i < dir_length; i++)
+    struct FAT32DirectoryEntry *entry;
+    while ((entry = dir_iterator_next(&iterator)) != NULL)
     {
-        struct FAT32DirectoryEntry current_content = dirtable.table[i];
+        struct FAT32DirectoryEntry current_content = *entry;
         bool is_current_content_name_na = memcmp(current_content.name, "\0\0\0\0\0\0\0\0", 8) == 0;
         bool is_current_content_ext_na = memcmp(current_content.ext, "\0\0\0", 3) == 0;
         if (is_current_content_name_na && is_current_content_ext_na)
@@ -658,18 +2458,19 @@ void print(char *buffer, uint32_t dir_cluster_number)
 
 void all_list_dir_content(char *buffer, uint32_t dir_cluster_number, int *dir_idx, int *level)
 {
-    // Read the directory table from the given cluster number
-    struct FAT32DirectoryTable dirtable;
-    read_clusters(&dirtable, dir_cluster_number, 1);
-
-    // Calculate the number of entries in the directory table
-    int dir_length = sizeof(struct FAT32DirectoryTable) / sizeof(struct FAT32DirectoryEntry);
+    // Walk the directory starting from the given cluster number
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, dir_cluster_number))
+    {
+        return;
+    }
 
-    // Iterate over each entry in the directory table
-    for (int i = 1; i < dir_length; i++)
+    // Iterate over each entry in every cluster of the directory
+    struct FAT32DirectoryEntry *entry;
+    while ((entry = dir_iterator_next(&iterator)) != NULL)
     {
         // Get the current directory entry
-        struct FAT32DirectoryEntry current_content = dirtable.table[i];
+        struct FAT32DirectoryEntry current_content = *entry;
 
         // Check if the name and extension are null (empty entry)
         bool is_current_content_name_na = memcmp(current_content.name, "\0\0\0\0\0\0\0\0", 8) == 0;
@@ -794,22 +2595,23 @@ void print_path_to_dir(char *buffer, uint32_t dir_cluster_number, const char *ta
 
 void find_and_print_path(char *buffer, uint32_t dir_cluster_number, const char *target_dir_name, int *dir_idx, int *level, bool *found)
 {
-    // Read the directory table from the given cluster number
-    struct FAT32DirectoryTable dirtable;
-    read_clusters(&dirtable, dir_cluster_number, 1);
-
-    // Calculate the number of entries in the directory table
-    int dir_length = sizeof(dirtable.table) / sizeof(dirtable.table[0]);
+    // Walk the directory starting from the given cluster number
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, dir_cluster_number))
+    {
+        return;
+    }
 
     *found = false;
     bool found_lokal = false;
-    // Iterate over each entry in the directory table
-    for (int i = 0; i < dir_length; i++)
+    // Iterate over each entry in every cluster of the directory
+    struct FAT32DirectoryEntry *entry;
+    while ((entry = dir_iterator_next(&iterator)) != NULL)
     {
         // if (*found) return; // Stop searching if we've found the directory
 
         // Get the current directory entry
-        struct FAT32DirectoryEntry current_content = dirtable.table[i];
+        struct FAT32DirectoryEntry current_content = *entry;
 
         // Check if the name and extension are null (empty entry)
         bool is_current_content_name_na = memcmp(current_content.name, "\0\0\0\0\0\0\0\0", 8) == 0;
@@ -1045,14 +2847,16 @@ void depth_limited_search_bm(char *buffer, uint32_t dir_cluster_number, char *pa
         return;
     }
 
-    struct FAT32DirectoryTable dirtable;
-    read_clusters(&dirtable, dir_cluster_number, 1);
-    int dir_length = sizeof(dirtable.table) / sizeof(dirtable.table[0]);
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, dir_cluster_number)) {
+        return;
+    }
 
     *found = false;
     bool local_found = false;
-    for (int i = 0; i < dir_length; i++) {
-        struct FAT32DirectoryEntry current_content = dirtable.table[i];
+    struct FAT32DirectoryEntry *entry;
+    while ((entry = dir_iterator_next(&iterator)) != NULL) {
+        struct FAT32DirectoryEntry current_content = *entry;
 
         bool is_current_content_name_na = memcmp(current_content.name, "\0\0\0\0\0\0\0\0", 8) == 0;
         bool is_current_content_ext_na = memcmp(current_content.ext, "\0\0\0", 3) == 0;
@@ -1111,47 +2915,46 @@ void depth_limited_search_bm(char *buffer, uint32_t dir_cluster_number, char *pa
             // custom_strncpy(request.ext, current_content.ext, 4);
             memcpy(request.name, current_content.name, 8);
             memcpy(request.ext, current_content.ext, 4);
-            request.buffer_size = current_content.filesize;
-            char file_content[current_content.filesize];
+            char file_content[FAT32_SEARCH_CHUNK_SIZE + 1];
             request.buf = file_content;
             request.parent_cluster_number = dir_cluster_number;
 
-            if (read(request) == 0) {
-                read_clusters(&dirtable, dir_cluster_number, 1);
-                current_content = dirtable.table[i];
-                // If the pattern matches, append the file details to the buffer
-                if (boyer_moore(pattern_input, file_content)) {
-                    for (int j = 0; j < *level; j++) {
-                        buffer[(*idx)] = ' ';
-                        (*idx)++;
-                        buffer[(*idx)] = ' ';
-                        (*idx)++;
-                        buffer[(*idx)] = ' ';
-                        (*idx)++;
-                    }
-                    for (int j = 0; j < 8; j++) {
-                        if (current_content.name[j] == '\0') break;
-                        buffer[(*idx)] = current_content.name[j];
-                        (*idx)++;
-                    }
-                    buffer[(*idx)] = '.';
+            if (fat32_file_contains(request, pattern_input, boyer_moore)) {
+                // Content shown in result is the first chunk of the file
+                struct FAT32FileRange range = {0};
+                request.buffer_size = FAT32_SEARCH_CHUNK_SIZE;
+                pread(request, &range);
+                file_content[range.transferred] = '\0';
+                for (int j = 0; j < *level; j++) {
+                    buffer[(*idx)] = ' ';
                     (*idx)++;
-                    for (int j = 0; j < 3; j++) {
-                        if (current_content.ext[j] == '\0') break;
-                        buffer[(*idx)] = current_content.ext[j];
-                        (*idx)++;
-                    }
                     buffer[(*idx)] = ' ';
                     (*idx)++;
-                    for (int j = 0; j < strlen(file_content); j++) {
-                        buffer[(*idx)] = file_content[j];
-                        (*idx)++;
-                    }
-                    buffer[(*idx)] = '\n';
+                    buffer[(*idx)] = ' ';
+                    (*idx)++;
+                }
+                for (int j = 0; j < 8; j++) {
+                    if (current_content.name[j] == '\0') break;
+                    buffer[(*idx)] = current_content.name[j];
+                    (*idx)++;
+                }
+                buffer[(*idx)] = '.';
+                (*idx)++;
+                for (int j = 0; j < 3; j++) {
+                    if (current_content.ext[j] == '\0') break;
+                    buffer[(*idx)] = current_content.ext[j];
+                    (*idx)++;
+                }
+                buffer[(*idx)] = ' ';
+                (*idx)++;
+                for (int j = 0; j < strlen(file_content); j++) {
+                    buffer[(*idx)] = file_content[j];
                     (*idx)++;
-
-                    *found = true;
                 }
+                buffer[(*idx)] = '\n';
+                (*idx)++;
+
+                *found = true;
             }
         }
     }
@@ -1177,14 +2980,16 @@ void depth_limited_search_kmp(char *buffer, uint32_t dir_cluster_number, char *p
         return;
     }
 
-    struct FAT32DirectoryTable dirtable;
-    read_clusters(&dirtable, dir_cluster_number, 1);
-    int dir_length = sizeof(dirtable.table) / sizeof(dirtable.table[0]);
+    struct FAT32DirectoryIterator iterator;
+    if (!dir_iterator_open(&iterator, dir_cluster_number)) {
+        return;
+    }
 
     *found = false;
     bool local_found = false;
-    for (int i = 0; i < dir_length; i++) {
-        struct FAT32DirectoryEntry current_content = dirtable.table[i];
+    struct FAT32DirectoryEntry *entry;
+    while ((entry = dir_iterator_next(&iterator)) != NULL) {
+        struct FAT32DirectoryEntry current_content = *entry;
 
         bool is_current_content_name_na = memcmp(current_content.name, "\0\0\0\0\0\0\0\0", 8) == 0;
         bool is_current_content_ext_na = memcmp(current_content.ext, "\0\0\0", 3) == 0;
@@ -1241,47 +3046,46 @@ void depth_limited_search_kmp(char *buffer, uint32_t dir_cluster_number, char *p
 
             memcpy(request.name, current_content.name, 8);
             memcpy(request.ext, current_content.ext, 4);
-            request.buffer_size = current_content.filesize;
-            char file_content[current_content.filesize];
+            char file_content[FAT32_SEARCH_CHUNK_SIZE + 1];
             request.buf = file_content;
             request.parent_cluster_number = dir_cluster_number;
 
-            if (read(request) == 0) {
-                read_clusters(&dirtable, dir_cluster_number, 1);
-                current_content = dirtable.table[i];
-                // If the pattern matches, append the file details to the buffer
-                if (knuth_morris_pratt(pattern_input, file_content)) {
-                    for (int j = 0; j < *level; j++) {
-                        buffer[(*idx)] = ' ';
-                        (*idx)++;
-                        buffer[(*idx)] = ' ';
-                        (*idx)++;
-                        buffer[(*idx)] = ' ';
-                        (*idx)++;
-                    }
-                    for (int j = 0; j < 8; j++) {
-                        if (current_content.name[j] == '\0') break;
-                        buffer[(*idx)] = current_content.name[j];
-                        (*idx)++;
-                    }
-                    buffer[(*idx)] = '.';
+            if (fat32_file_contains(request, pattern_input, knuth_morris_pratt)) {
+                // Content shown in result is the first chunk of the file
+                struct FAT32FileRange range = {0};
+                request.buffer_size = FAT32_SEARCH_CHUNK_SIZE;
+                pread(request, &range);
+                file_content[range.transferred] = '\0';
+                for (int j = 0; j < *level; j++) {
+                    buffer[(*idx)] = ' ';
                     (*idx)++;
-                    for (int j = 0; j < 3; j++) {
-                        if (current_content.ext[j] == '\0') break;
-                        buffer[(*idx)] = current_content.ext[j];
-                        (*idx)++;
-                    }
                     buffer[(*idx)] = ' ';
                     (*idx)++;
-                    for (int j = 0; j < strlen(file_content); j++) {
-                        buffer[(*idx)] = file_content[j];
-                        (*idx)++;
-                    }
-                    buffer[(*idx)] = '\n';
+                    buffer[(*idx)] = ' ';
+                    (*idx)++;
+                }
+                for (int j = 0; j < 8; j++) {
+                    if (current_content.name[j] == '\0') break;
+                    buffer[(*idx)] = current_content.name[j];
+                    (*idx)++;
+                }
+                buffer[(*idx)] = '.';
+                (*idx)++;
+                for (int j = 0; j < 3; j++) {
+                    if (current_content.ext[j] == '\0') break;
+                    buffer[(*idx)] = current_content.ext[j];
+                    (*idx)++;
+                }
+                buffer[(*idx)] = ' ';
+                (*idx)++;
+                for (int j = 0; j < strlen(file_content); j++) {
+                    buffer[(*idx)] = file_content[j];
                     (*idx)++;
-
-                    *found = true;
                 }
+                buffer[(*idx)] = '\n';
+                (*idx)++;
+
+                *found = true;
             }
         }
     }
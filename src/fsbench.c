@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "header/filesystem/fat32.h"
+#include "header/driver/disk.h"
+#include "header/stdlib/string.h"
+
+/**
+ * fsbench - Host side FAT32 microbenchmark.
+ * Build synthetic tree on memory-backed storage, time each FAT32 operation
+ * and count block request / block transferred per operation
+ *
+ * Usage: ./fsbench [--json] [--iterations <n>]
+ */
+
+#define FSBENCH_STORAGE_SIZE  (4 * 1024 * 1024)
+#define FSBENCH_OUTPUT_SIZE   (64 * 1024)
+#define FSBENCH_MAX_NODE      512
+#define FSBENCH_MAX_FILE_SIZE (96 * 1024)
+#define FSBENCH_MAX_PATH      128
+#define FSBENCH_FILE_READ_CHUNK 512
+#define FSBENCH_RANDOM_READ_COUNT 8
+#define FSBENCH_APPEND_FILE_COUNT 2
+#define FSBENCH_APPEND_COUNT      16
+
+/**
+ * BenchNode - File or folder created by a scenario, kept in creation order
+ *
+ * @param name                  8-byte name
+ * @param ext                   3-byte extension, "dir" for folder
+ * @param parent_cluster_number Parent folder cluster
+ * @param cluster_number        Own cluster for folder, resolved after creation
+ * @param size                  File size, 0 for folder
+ * @param path                  Absolute path, used by resolve_path()
+ */
+struct BenchNode {
+    char     name[8];
+    char     ext[3];
+    uint32_t parent_cluster_number;
+    uint32_t cluster_number;
+    uint32_t size;
+    char     path[FSBENCH_MAX_PATH];
+};
+
+/**
+ * BenchCounter - Block device counter, updated by memory-backed read_blocks / write_blocks
+ *
+ * @param read_request  read_blocks() call
+ * @param write_request write_blocks() call
+ * @param block_read    Block read
+ * @param block_written Block written
+ */
+struct BenchCounter {
+    uint64_t read_request;
+    uint64_t write_request;
+    uint64_t block_read;
+    uint64_t block_written;
+};
+
+// Global variable
+uint8_t *image_storage;
+struct BenchCounter counter;
+
+static struct BenchNode node[FSBENCH_MAX_NODE];
+static uint32_t node_count;
+static char file_content[FSBENCH_MAX_FILE_SIZE];
+static char read_buffer[FSBENCH_MAX_FILE_SIZE];
+static char output_buffer[FSBENCH_OUTPUT_SIZE];
+static int  result_count;
+static bool output_json;
+
+void read_blocks(void *ptr, uint32_t logical_block_address, uint32_t block_count) {
+    counter.read_request++;
+    counter.block_read += block_count;
+    memcpy(ptr, image_storage + BLOCK_SIZE * logical_block_address, BLOCK_SIZE * block_count);
+}
+
+void write_blocks(const void *ptr, uint32_t logical_block_address, uint32_t block_count) {
+    counter.write_request++;
+    counter.block_written += block_count;
+    memcpy(image_storage + BLOCK_SIZE * logical_block_address, ptr, BLOCK_SIZE * block_count);
+}
+
+// Storage is in memory, nothing to gain from holding writes back
+void disk_plug(void) {}
+
+void disk_unplug(void) {}
+
+void disk_dispatch(void) {}
+
+uint32_t disk_block_count(void) {
+    return FSBENCH_STORAGE_SIZE / BLOCK_SIZE;
+}
+
+/* -- Measurement -- */
+
+static uint64_t bench_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/**
+ * BenchMeasure - One operation measurement in progress
+ *
+ * @param count   Amount of operation done
+ * @param elapsed Total elapsed nanosecond
+ * @param io      Block device counter accumulated during the operations
+ */
+struct BenchMeasure {
+    uint64_t            count;
+    uint64_t            elapsed;
+    struct BenchCounter io;
+    uint64_t            start;
+    struct BenchCounter io_start;
+};
+
+static void bench_begin(struct BenchMeasure *measure) {
+    measure->io_start = counter;
+    measure->start    = bench_now_ns();
+}
+
+static void bench_end(struct BenchMeasure *measure) {
+    measure->elapsed          += bench_now_ns() - measure->start;
+    measure->count++;
+    measure->io.read_request  += counter.read_request - measure->io_start.read_request;
+    measure->io.write_request += counter.write_request - measure->io_start.write_request;
+    measure->io.block_read    += counter.block_read - measure->io_start.block_read;
+    measure->io.block_written += counter.block_written - measure->io_start.block_written;
+}
+
+static void bench_report(const char *scenario, const char *operation, struct BenchMeasure *measure) {
+    double count = measure->count > 0 ? (double)measure->count : 1.0;
+    if (output_json) {
+        printf("%s  {\"scenario\": \"%s\", \"operation\": \"%s\", \"count\": %llu, \"total_ns\": %llu, "
+               "\"ns_per_op\": %.1f, \"read_request\": %llu, \"write_request\": %llu, "
+               "\"block_read\": %llu, \"block_written\": %llu, "
+               "\"block_read_per_op\": %.2f, \"block_written_per_op\": %.2f}",
+            result_count > 0 ? ",\n" : "", scenario, operation,
+            (unsigned long long)measure->count, (unsigned long long)measure->elapsed,
+            measure->elapsed / count,
+            (unsigned long long)measure->io.read_request, (unsigned long long)measure->io.write_request,
+            (unsigned long long)measure->io.block_read, (unsigned long long)measure->io.block_written,
+            measure->io.block_read / count, measure->io.block_written / count);
+    } else {
+        printf("%s,%s,%llu,%llu,%.1f,%llu,%llu,%llu,%llu,%.2f,%.2f\n",
+            scenario, operation,
+            (unsigned long long)measure->count, (unsigned long long)measure->elapsed,
+            measure->elapsed / count,
+            (unsigned long long)measure->io.read_request, (unsigned long long)measure->io.write_request,
+            (unsigned long long)measure->io.block_read, (unsigned long long)measure->io.block_written,
+            measure->io.block_read / count, measure->io.block_written / count);
+    }
+    result_count++;
+}
+
+/* -- Synthetic tree -- */
+
+static struct FAT32DriverRequest bench_request(struct BenchNode *target, void *buf, uint32_t buffer_size) {
+    struct FAT32DriverRequest request = {
+        .buf                   = buf,
+        .parent_cluster_number = target->parent_cluster_number,
+        .buffer_size           = buffer_size,
+    };
+    memcpy(request.name, target->name, 8);
+    memcpy(request.ext, target->ext, 3);
+    return request;
+}
+
+static struct BenchNode* bench_add_node(const char *prefix, uint32_t index, const char *ext, uint32_t parent_cluster_number, uint32_t size) {
+    if (node_count >= FSBENCH_MAX_NODE) {
+        fprintf(stderr, "fsbench: too many node\n");
+        exit(1);
+    }
+    struct BenchNode *target = &node[node_count++];
+    char name[16];
+    memset(target, 0, sizeof(struct BenchNode));
+    snprintf(name, sizeof(name), "%s%u", prefix, index);
+    memcpy(target->name, name, strnlen(name, 8));
+    memcpy(target->ext, ext, 3);
+    target->parent_cluster_number = parent_cluster_number;
+    target->size                  = size;
+    return target;
+}
+
+// Timing of a broken read is meaningless, every read is compared with the content it was written from
+static void bench_verify(const char *scenario, const char *operation, struct FAT32DriverRequest request, int8_t retcode,
+                         const void *expected, const void *actual, uint32_t size) {
+    if (retcode != 0 || (size > 0 && memcmp(expected, actual, size) != 0)) {
+        fprintf(stderr, "fsbench: %s %s %.8s.%.3s returned wrong content (%d)\n", scenario, operation, request.name, request.ext, retcode);
+        exit(1);
+    }
+}
+
+// Parent cluster 0 mean "last created folder", resolved right before the node is written
+// Deep: one nested chain of folder, each holding one text file
+static void bench_build_deep(uint32_t depth) {
+    uint32_t parent = ROOT_CLUSTER_NUMBER;
+    for (uint32_t i = 0; i < depth; i++) {
+        bench_add_node("deep", i, "dir", parent, 0);
+        bench_add_node("file", i, "txt", 0, CLUSTER_SIZE);
+        parent = 0;
+    }
+}
+
+// Wide: many folder in root, each holding a few text file
+static void bench_build_wide(uint32_t folder_count, uint32_t file_per_folder) {
+    for (uint32_t i = 0; i < folder_count; i++) {
+        bench_add_node("wide", i, "dir", ROOT_CLUSTER_NUMBER, 0);
+        for (uint32_t j = 0; j < file_per_folder; j++)
+            bench_add_node("f", i * file_per_folder + j, "txt", 0, CLUSTER_SIZE);
+    }
+}
+
+static void bench_build_small(uint32_t file_count) {
+    for (uint32_t i = 0; i < file_count; i++)
+        bench_add_node("small", i, "txt", ROOT_CLUSTER_NUMBER, CLUSTER_SIZE);
+}
+
+static void bench_build_large(uint32_t file_count) {
+    for (uint32_t i = 0; i < file_count; i++)
+        bench_add_node("large", i, "txt", ROOT_CLUSTER_NUMBER, FSBENCH_MAX_FILE_SIZE);
+}
+
+// Log file in root grown by interleaved append, not part of node list
+static struct FAT32DriverRequest bench_append_request(uint32_t index, void *buf, uint32_t buffer_size) {
+    struct FAT32DriverRequest request = {
+        .buf                   = buf,
+        .parent_cluster_number = ROOT_CLUSTER_NUMBER,
+        .buffer_size           = buffer_size,
+    };
+    char name[16];
+    snprintf(name, sizeof(name), "append%u", index);
+    memcpy(request.name, name, strnlen(name, 8));
+    memcpy(request.ext, "log", 3);
+    return request;
+}
+
+// Resolve parent cluster of node created with parent 0, which mean "last created folder"
+static void bench_resolve_parent(uint32_t index) {
+    if (node[index].parent_cluster_number != 0)
+        return;
+    for (int32_t i = (int32_t)index - 1; i >= 0; i--) {
+        if (node[i].size == 0 && !memcmp(node[i].ext, "dir", 3)) {
+            node[index].parent_cluster_number = node[i].cluster_number;
+            return;
+        }
+    }
+}
+
+// Absolute path of node, built from path of its already created parent folder
+static void bench_node_path(uint32_t index) {
+    const char *parent_path = "";
+    for (int32_t i = (int32_t)index - 1; i >= 0; i--) {
+        if (node[i].size == 0 && node[i].cluster_number == node[index].parent_cluster_number) {
+            parent_path = node[i].path;
+            break;
+        }
+    }
+    snprintf(node[index].path, FSBENCH_MAX_PATH, "%s/%.8s.%.3s", parent_path, node[index].name, node[index].ext);
+}
+
+/* -- Scenario runner -- */
+
+static void bench_format(void) {
+    memset(image_storage, 0, FSBENCH_STORAGE_SIZE);
+    initialize_filesystem_fat32();
+}
+
+static void bench_run_scenario(const char *scenario, uint32_t iterations) {
+    struct BenchMeasure measure_write = {0}, measure_read = {0}, measure_read_directory = {0},
+                        measure_print = {0}, measure_search_bm = {0}, measure_search_kmp = {0},
+                        measure_delete = {0}, measure_resolve = {0}, measure_file_read = {0},
+                        measure_pread_random = {0}, measure_append = {0}, measure_read_appended = {0};
+
+    bench_format();
+    for (uint32_t i = 0; i < node_count; i++) {
+        bench_resolve_parent(i);
+        bench_node_path(i);
+        struct BenchNode *target = &node[i];
+        struct FAT32DriverRequest request = bench_request(target, file_content, target->size);
+        bench_begin(&measure_write);
+        int8_t retcode = write(request);
+        bench_end(&measure_write);
+        if (retcode != 0) {
+            fprintf(stderr, "fsbench: %s write %.8s.%.3s failed with %d\n", scenario, target->name, target->ext, retcode);
+            exit(1);
+        }
+        if (target->size == 0)
+            target->cluster_number = move_to_child_directory(request);
+    }
+
+    // Files growing in turn one cluster at a time, their layout show up when read back
+    for (uint32_t i = 0; i < FSBENCH_APPEND_FILE_COUNT; i++)
+        bench_verify(scenario, "write", bench_append_request(i, NULL, 0), write(bench_append_request(i, file_content, CLUSTER_SIZE)), NULL, NULL, 0);
+    for (uint32_t k = 0; k < FSBENCH_APPEND_COUNT; k++) {
+        for (uint32_t i = 0; i < FSBENCH_APPEND_FILE_COUNT; i++) {
+            bench_begin(&measure_append);
+            int8_t retcode = append(bench_append_request(i, file_content, CLUSTER_SIZE));
+            bench_end(&measure_append);
+            bench_verify(scenario, "append", bench_append_request(i, NULL, 0), retcode, NULL, NULL, 0);
+        }
+    }
+
+    // Remount so first iteration of every operation start with cold cache
+    initialize_filesystem_fat32();
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        for (uint32_t i = 0; i < node_count; i++) {
+            struct BenchNode *target = &node[i];
+            if (target->size == 0) {
+                struct FAT32DriverRequest request = bench_request(target, read_buffer, sizeof(struct FAT32DirectoryTable));
+                bench_begin(&measure_read_directory);
+                read_directory(request);
+                bench_end(&measure_read_directory);
+            } else {
+                struct FAT32DriverRequest request = bench_request(target, read_buffer, target->size);
+                memset(read_buffer, 0, target->size);
+                bench_begin(&measure_read);
+                int8_t retcode = read(request);
+                bench_end(&measure_read);
+                bench_verify(scenario, "read", request, retcode, file_content, read_buffer, target->size);
+            }
+        }
+
+        // Small sequential read through descriptor, every call continue from the cached cluster
+        for (uint32_t i = 0; i < node_count; i++) {
+            struct FAT32FileDescriptor descriptor;
+            if (node[i].size == 0 || file_open(bench_request(&node[i], NULL, 0), &descriptor) != 0)
+                continue;
+            uint32_t transferred;
+            uint32_t position = 0;
+            do {
+                memset(read_buffer, 0, FSBENCH_FILE_READ_CHUNK);
+                bench_begin(&measure_file_read);
+                int8_t retcode = file_read(&descriptor, read_buffer, FSBENCH_FILE_READ_CHUNK, &transferred);
+                bench_end(&measure_file_read);
+                bench_verify(scenario, "file_read", bench_request(&node[i], NULL, 0), retcode, file_content + position, read_buffer, transferred);
+                position += transferred;
+            } while (transferred > 0);
+            file_close(&descriptor);
+            bench_verify(scenario, "file_read", bench_request(&node[i], NULL, 0), position == node[i].size ? 0 : -1, NULL, NULL, 0);
+        }
+
+        // Random small positional read, seek is mapped through extent cache instead of walking the chain
+        uint32_t seed = iteration + 1;
+        for (uint32_t i = 0; i < node_count; i++) {
+            if (node[i].size <= CLUSTER_SIZE)
+                continue;
+            for (uint32_t k = 0; k < FSBENCH_RANDOM_READ_COUNT; k++) {
+                seed = seed * 1103515245u + 12345u;
+                struct FAT32FileRange range = {.offset = (seed >> 8) % node[i].size};
+                struct FAT32DriverRequest request = bench_request(&node[i], read_buffer, FSBENCH_FILE_READ_CHUNK);
+                memset(read_buffer, 0, FSBENCH_FILE_READ_CHUNK);
+                bench_begin(&measure_pread_random);
+                int8_t retcode = pread(request, &range);
+                bench_end(&measure_pread_random);
+                bench_verify(scenario, "pread", request, retcode, file_content + range.offset, read_buffer, range.transferred);
+            }
+        }
+
+        for (uint32_t i = 0; i < FSBENCH_APPEND_FILE_COUNT; i++) {
+            struct FAT32DriverRequest request = bench_append_request(i, read_buffer, (FSBENCH_APPEND_COUNT + 1) * CLUSTER_SIZE);
+            memset(read_buffer, 0, request.buffer_size);
+            bench_begin(&measure_read_appended);
+            int8_t retcode = read(request);
+            bench_end(&measure_read_appended);
+            // Every appended chunk is the first cluster of file_content
+            for (uint32_t k = 0; k <= FSBENCH_APPEND_COUNT; k++)
+                bench_verify(scenario, "read_appended", request, retcode, file_content, read_buffer + k * CLUSTER_SIZE, CLUSTER_SIZE);
+        }
+
+        for (uint32_t i = 0; i < node_count; i++) {
+            struct FAT32PathRequest path_request = {.path = node[i].path, .cwd_cluster_number = ROOT_CLUSTER_NUMBER};
+            struct FAT32ResolvedPath resolved;
+            bench_begin(&measure_resolve);
+            resolve_path(path_request, &resolved);
+            bench_end(&measure_resolve);
+        }
+
+        bench_begin(&measure_print);
+        print(output_buffer, ROOT_CLUSTER_NUMBER);
+        bench_end(&measure_print);
+
+        bench_begin(&measure_search_bm);
+        search_dls_bm(output_buffer, ROOT_CLUSTER_NUMBER, "needle");
+        bench_end(&measure_search_bm);
+
+        bench_begin(&measure_search_kmp);
+        search_dls_kmp(output_buffer, ROOT_CLUSTER_NUMBER, "needle");
+        bench_end(&measure_search_kmp);
+    }
+
+    for (uint32_t i = 0; i < FSBENCH_APPEND_FILE_COUNT; i++)
+        delete(bench_append_request(i, NULL, 0));
+
+    // Children first, so every folder is already empty when deleted
+    for (int32_t i = (int32_t)node_count - 1; i >= 0; i--) {
+        struct FAT32DriverRequest request = bench_request(&node[i], NULL, 0);
+        bench_begin(&measure_delete);
+        delete(request);
+        bench_end(&measure_delete);
+    }
+
+    bench_report(scenario, "write", &measure_write);
+    bench_report(scenario, "read", &measure_read);
+    bench_report(scenario, "read_directory", &measure_read_directory);
+    bench_report(scenario, "file_read", &measure_file_read);
+    bench_report(scenario, "pread_random", &measure_pread_random);
+    bench_report(scenario, "append", &measure_append);
+    bench_report(scenario, "read_appended", &measure_read_appended);
+    bench_report(scenario, "resolve_path", &measure_resolve);
+    bench_report(scenario, "print", &measure_print);
+    bench_report(scenario, "search_dls_bm", &measure_search_bm);
+    bench_report(scenario, "search_dls_kmp", &measure_search_kmp);
+    bench_report(scenario, "delete", &measure_delete);
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t iterations = 10;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--json")) {
+            output_json = true;
+        } else if (!strcmp(argv[i], "--iterations") && i + 1 < argc) {
+            iterations = (uint32_t)atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "fsbench: ./fsbench [--json] [--iterations <n>]\n");
+            exit(1);
+        }
+    }
+
+    image_storage = malloc(FSBENCH_STORAGE_SIZE);
+
+    // Search treat file content as C string and copy it into result, keep the string short.
+    // Size is multiple of CLUSTER_SIZE since read() always write whole cluster into buffer
+    for (uint32_t i = 0; i < FSBENCH_MAX_FILE_SIZE; i++)
+        file_content[i] = 'a' + i % 26;
+    memcpy(file_content + 64, "needle", 6);
+    file_content[96] = '\0';
+
+    if (output_json)
+        printf("[\n");
+    else
+        printf("scenario,operation,count,total_ns,ns_per_op,read_request,write_request,block_read,block_written,block_read_per_op,block_written_per_op\n");
+
+    node_count = 0;
+    bench_build_deep(9);
+    bench_run_scenario("deep", iterations);
+
+    node_count = 0;
+    bench_build_wide(40, 4);
+    bench_run_scenario("wide", iterations);
+
+    node_count = 0;
+    bench_build_small(60);
+    bench_run_scenario("small", iterations);
+
+    node_count = 0;
+    bench_build_large(4);
+    bench_run_scenario("large", iterations);
+
+    if (output_json)
+        printf("\n]\n");
+
+    free(image_storage);
+    return 0;
+}
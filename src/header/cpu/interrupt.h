@@ -145,6 +145,9 @@ void set_tss_kernel_current_stack(void);
 // Activate PIC mask for keyboard only
 void activate_keyboard_interrupt(void);
 
+// Activate PIC mask for primary ATA (IRQ 14) and slave PIC cascade
+void activate_disk_interrupt(void);
+
 // I/O port wait, around 1-4 microsecond, for I/O synchronization purpose
 void io_wait(void);
 
@@ -37,4 +37,54 @@ void out16(uint16_t port, uint16_t data);
  */
 uint16_t in16(uint16_t port);
 
+/**
+ *  Send 32-bit data to the given I/O port
+ *
+ *  @param port The I/O port to send the data to
+ *  @param data The data to send to the I/O port
+ */
+void out32(uint16_t port, uint32_t data);
+
+/**
+ *  Read 32-bit data from the given I/O port
+ *
+ *  @param port The I/O port to request the data
+ *  @return Recieved data from the corresponding I/O port
+ */
+uint32_t in32(uint16_t port);
+
+/**
+ *  Read count 16-bit words from the given I/O port into buffer with rep insw.
+ *  Inlined on purpose, used for ATA PIO data transfer where call overhead per word matters
+ *
+ *  @param port   The I/O port to request the data
+ *  @param buffer Destination buffer, should be at least count * 2 bytes
+ *  @param count  Amount of 16-bit words to read
+ */
+static inline void in16_rep(uint16_t port, void *buffer, uint32_t count) {
+    __asm__ volatile(
+        "cld; rep insw"
+        : "+D"(buffer), "+c"(count)
+        : "d"(port)
+        : "memory"
+        );
+}
+
+/**
+ *  Send count 16-bit words from buffer to the given I/O port with rep outsw.
+ *  Inlined on purpose, used for ATA PIO data transfer where call overhead per word matters
+ *
+ *  @param port   The I/O port to send the data to
+ *  @param buffer Source buffer, should be at least count * 2 bytes
+ *  @param count  Amount of 16-bit words to send
+ */
+static inline void out16_rep(uint16_t port, const void *buffer, uint32_t count) {
+    __asm__ volatile(
+        "cld; rep outsw"
+        : "+S"(buffer), "+c"(count)
+        : "d"(port)
+        : "memory"
+        );
+}
+
 #endif
@@ -12,9 +12,65 @@
 #define ATA_STATUS_DF    0x20
 #define ATA_STATUS_ERR   0x01
 
+/* -- ATA primary bus I/O ports -- */
+#define ATA_PRIMARY_DATA         0x1F0
+#define ATA_PRIMARY_ERROR        0x1F1
+#define ATA_PRIMARY_SECTOR_COUNT 0x1F2
+#define ATA_PRIMARY_LBA_LOW      0x1F3
+#define ATA_PRIMARY_LBA_MID      0x1F4
+#define ATA_PRIMARY_LBA_HIGH     0x1F5
+#define ATA_PRIMARY_DRIVE_SELECT 0x1F6
+#define ATA_PRIMARY_COMMAND      0x1F7
+#define ATA_PRIMARY_STATUS       0x1F7
+#define ATA_PRIMARY_ALT_STATUS   0x3F6
+#define ATA_PRIMARY_CONTROL      0x3F6
+
+// Device control register, nIEN set will disable drive interrupt (INTRQ)
+#define ATA_CONTROL_NIEN 0x02
+
+/* -- ATA commands -- */
+#define ATA_CMD_READ_PIO          0x20
+#define ATA_CMD_WRITE_PIO         0x30
+#define ATA_CMD_READ_MULTIPLE     0xC4
+#define ATA_CMD_WRITE_MULTIPLE    0xC5
+#define ATA_CMD_SET_MULTIPLE_MODE 0xC6
+#define ATA_CMD_READ_DMA          0xC8
+#define ATA_CMD_WRITE_DMA         0xCA
+#define ATA_CMD_IDENTIFY          0xEC
+
+// LBA48 variant, 16-bit sector count and 48-bit address written as two byte into each task file register
+#define ATA_CMD_READ_PIO_EXT       0x24
+#define ATA_CMD_READ_DMA_EXT       0x25
+#define ATA_CMD_READ_MULTIPLE_EXT  0x29
+#define ATA_CMD_WRITE_PIO_EXT      0x34
+#define ATA_CMD_WRITE_DMA_EXT      0x35
+#define ATA_CMD_WRITE_MULTIPLE_EXT 0x39
+
+/* -- IDENTIFY DEVICE word index -- */
+// Lower byte is maximum sector per DRQ block for READ/WRITE MULTIPLE
+#define ATA_IDENTIFY_MAX_MULTIPLE    47
+// 2 word, total addressable sector with LBA28
+#define ATA_IDENTIFY_LBA28_SECTORS   60
+// Bit 10 set if 48-bit address feature set is supported
+#define ATA_IDENTIFY_COMMAND_SET_2   83
+#define ATA_IDENTIFY_LBA48_SUPPORTED (1 << 10)
+// 4 word, total addressable sector with LBA48, only lower 2 word is used as block address is 32-bit
+#define ATA_IDENTIFY_LBA48_SECTORS   100
+
+#define ATA_LBA28_MAX_ADDRESS     0x0FFFFFFF
+#define ATA_LBA28_MAX_BLOCK_COUNT 256
+
 #define BLOCK_SIZE      512
 #define HALF_BLOCK_SIZE (BLOCK_SIZE/2)
 
+#define ATA_REQUEST_QUEUE_SIZE   16
+#define ATA_REQUEST_SEGMENT_MAX  16
+#define ATA_PLUG_LIST_SIZE       32
+// Largest single LBA48 command (1 MiB). Merged request of 16 segment need at most 32 PRD, fit PRD table
+#define ATA_MAX_BLOCK_PER_COMMAND 2048
+
+struct ProcessControlBlock;
+
 
 
 // Block buffer data type - @param buf Byte buffer with size of BLOCK_SIZE
@@ -22,29 +78,195 @@ struct BlockBuffer {
     uint8_t buf[BLOCK_SIZE];
 } __attribute__((packed));
 
+/**
+ * ATADriverState - Contain all ATA driver states
+ *
+ * @param drive_present         Whether primary master drive respond to IDENTIFY DEVICE
+ * @param multiple_sector_count Sector per DRQ block negotiated with SET MULTIPLE MODE, 1 if multiple mode is unused
+ * @param dma_enabled           Whether bus master IDE DMA backend is used instead of PIO
+ * @param interrupt_enabled     Whether request completion is driven by IRQ 14, otherwise request is polled
+ * @param lba48_enabled         Whether drive support 48-bit address feature set
+ * @param total_block_count     Addressable block of the drive, capped to 32-bit
+ */
+struct ATADriverState {
+    bool     drive_present;
+    uint8_t  multiple_sector_count;
+    bool     dma_enabled;
+    bool     interrupt_enabled;
+    bool     lba48_enabled;
+    uint32_t total_block_count;
+} __attribute__((packed));
+
+/**
+ * ATASegment - Memory segment of a request, merged request carry one segment per original request
+ *
+ * @param buf         Pointer to data buffer, positive integer multiple of BLOCK_SIZE
+ * @param block_count How many block this segment hold
+ */
+struct ATASegment {
+    void     *buf;
+    uint16_t block_count;
+} __attribute__((packed));
+
+/**
+ * ATARequest - One entry in kernel block request queue, owned by submitter until completed.
+ * Segments are consecutive on disk starting from logical_block_address, but not necessarily in memory
+ *
+ * @param segment               Memory segments, transferred in order
+ * @param segment_count         Amount of used segment
+ * @param logical_block_address Starting block address
+ * @param block_count           How many block to transfer, sum of every segment block_count
+ * @param block_done            How many block already transferred, used by PIO
+ * @param segment_index         Segment currently transferred, used by PIO
+ * @param segment_block_done    Block already transferred in current segment, used by PIO
+ * @param write                 True for write request, false for read request
+ * @param use_dma               Whether this request is served by bus master DMA
+ * @param completed             Set by disk ISR when request is done
+ * @param success               Valid after completed, false if drive report error
+ * @param waiting_process       Process put into PROCESS_STATE_WAITING for this request, can be NULL
+ */
+struct ATARequest {
+    struct ATASegment          segment[ATA_REQUEST_SEGMENT_MAX];
+    uint8_t                    segment_count;
+    uint32_t                   logical_block_address;
+    uint16_t                   block_count;
+    uint16_t                   block_done;
+    uint8_t                    segment_index;
+    uint16_t                   segment_block_done;
+    bool                       write;
+    bool                       use_dma;
+    volatile bool              completed;
+    bool                       success;
+    struct ProcessControlBlock *waiting_process;
+};
+
+/**
+ * ATARequestQueue - FIFO of pending ATARequest, head is the request currently served by drive.
+ * Hold request of one ATA_submit_and_wait() batch at a time: one request for single read / write, many for plug list dispatch
+ *
+ * @param request Circular buffer of request pointer
+ * @param head    Index of head request
+ * @param count   Amount of request in queue
+ */
+struct ATARequestQueue {
+    struct ATARequest *request[ATA_REQUEST_QUEUE_SIZE];
+    uint8_t           head;
+    uint8_t           count;
+};
+
+/**
+ * ATAPlugList - Write request held back by I/O scheduler while plugged, dispatched sorted & merged on unplug
+ *
+ * @param depth   Nested disk_plug() count, list is dispatched when it drop back to 0
+ * @param write   Pending write, buffer must stay valid until dispatched
+ * @param lba     Starting block address of each pending write
+ * @param count   Amount of pending write
+ */
+struct ATAPlugList {
+    uint8_t           depth;
+    struct ATASegment write[ATA_PLUG_LIST_SIZE];
+    uint32_t          lba[ATA_PLUG_LIST_SIZE];
+    uint8_t           count;
+};
+
+/**
+ * ATASchedulerStatistics - I/O scheduler counters since boot
+ *
+ * @param write_queued    Write request held in plug list instead of dispatched directly
+ * @param write_merged    Write request merged into command of its LBA-adjacent neighbour
+ * @param write_replaced  Pending write superseded by newer write of exactly the same blocks
+ * @param write_reordered Write request dispatched at different position than submission order
+ * @param command_read    ATA read command sent to drive
+ * @param command_write   ATA write command sent to drive
+ * @param block_read      Block read from drive
+ * @param block_written   Block written into drive
+ */
+struct ATASchedulerStatistics {
+    uint32_t write_queued;
+    uint32_t write_merged;
+    uint32_t write_replaced;
+    uint32_t write_reordered;
+    uint32_t command_read;
+    uint32_t command_write;
+    uint32_t block_read;
+    uint32_t block_written;
+} __attribute__((packed));
+
 
 
 /**
- * ATA PIO logical block address read blocks. Will blocking until read is completed.
- * Note: ATA PIO will use 2-bytes per read/write operation.
+ * Identify primary master drive and negotiate READ/WRITE MULTIPLE block size with SET MULTIPLE MODE.
+ * If PCI bus master IDE controller is found, read_blocks() / write_blocks() will use DMA backend.
+ * Afterward, drive interrupt is enabled and every request is completed by disk_isr().
+ * Should be called once after IDT is loaded, before any read_blocks() / write_blocks().
+ * If not called, single sector PIO with polling is used
+ */
+void initialize_disk(void);
+
+/**
+ * Handling primary ATA interrupt (IRQ 14). Transfer next PIO DRQ block or finish DMA transfer,
+ * complete head request in queue, wake up the waiting process and start next queued request
+ */
+void disk_isr(void);
+
+/**
+ * Start holding write_blocks() in I/O scheduler plug list, can be nested.
+ * While plugged write_blocks() return immediately, so written buffer must stay valid until disk_unplug().
+ * read_blocks() overlapping pending write will dispatch the plug list first
+ */
+void disk_plug(void);
+
+/**
+ * End of plugged section. On outermost call, pending writes are sorted by LBA,
+ * LBA-adjacent writes are merged into one ATA command, then dispatched. Will blocking until all is written
+ */
+void disk_unplug(void);
+
+/**
+ * Dispatch pending plugged writes immediately without leaving plugged section.
+ * Used when buffer of pending write is about to be reused. Will blocking until all is written
+ */
+void disk_dispatch(void);
+
+/**
+ * Get capacity of the drive reported by IDENTIFY DEVICE
+ *
+ * @return Addressable block count, 0 if drive is not present or initialize_disk() is not called
+ */
+uint32_t disk_block_count(void);
+
+/**
+ * Copy I/O scheduler statistics
+ *
+ * @param statistics Pointer for storing the counters
+ */
+void disk_scheduler_statistics(struct ATASchedulerStatistics *statistics);
+
+/**
+ * ATA logical block address read blocks. Will blocking until read is completed.
+ * Caller process is put into PROCESS_STATE_WAITING and CPU is halted until disk ISR complete the request.
+ * Note: Use bus master DMA if available, otherwise ATA PIO with 2-bytes per read/write operation.
  * Recommended to use struct BlockBuffer
  *
  * @param ptr                   Pointer for storing reading data, this pointer should point to already allocated memory location.
  *                              With allocated size positive integer multiple of BLOCK_SIZE, ex: buf[1024]
  * @param logical_block_address Block address to read data from. Use LBA addressing
- * @param block_count           How many block to read, starting from block logical_block_address to lba-1
+ * @param block_count           How many block to read, starting from block logical_block_address to lba-1.
+ *                              Split into command of ATA_MAX_BLOCK_PER_COMMAND (LBA48) or 256 block (LBA28)
  */
-void read_blocks(void* ptr, uint32_t logical_block_address, uint8_t block_count);
+void read_blocks(void* ptr, uint32_t logical_block_address, uint32_t block_count);
 
 /**
- * ATA PIO logical block address write blocks. Will blocking until write is completed.
- * Note: ATA PIO will use 2-bytes per read/write operation.
+ * ATA logical block address write blocks. Will blocking until write is completed.
+ * Caller process is put into PROCESS_STATE_WAITING and CPU is halted until disk ISR complete the request.
+ * Note: Use bus master DMA if available, otherwise ATA PIO with 2-bytes per read/write operation.
  * Recommended to use struct BlockBuffer
  *
  * @param ptr                   Pointer to data that to be written into disk. Memory pointed should be positive integer multiple of BLOCK_SIZE
  * @param logical_block_address Block address to write data into. Use LBA addressing
- * @param block_count           How many block to write, starting from block logical_block_address to lba-1
+ * @param block_count           How many block to write, starting from block logical_block_address to lba-1.
+ *                              Split into command of ATA_MAX_BLOCK_PER_COMMAND (LBA48) or 256 block (LBA28)
  */
-void write_blocks(const void* ptr, uint32_t logical_block_address, uint8_t block_count);
+void write_blocks(const void* ptr, uint32_t logical_block_address, uint32_t block_count);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef _IDEDMA_H
+#define _IDEDMA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "header/driver/pci.h"
+#include "header/driver/disk.h"
+
+/* -- Bus master IDE register offset, primary channel, relative to BAR4 -- */
+#define IDE_BM_REGISTER_COMMAND 0x0
+#define IDE_BM_REGISTER_STATUS  0x2
+#define IDE_BM_REGISTER_PRDT    0x4
+
+#define IDE_BM_COMMAND_START    0x01
+#define IDE_BM_COMMAND_READ     0x08   // Bus master write into memory, used for ATA read
+
+#define IDE_BM_STATUS_ACTIVE    0x01
+#define IDE_BM_STATUS_ERROR     0x02
+#define IDE_BM_STATUS_INTERRUPT 0x04
+
+/* -- Physical Region Descriptor constants -- */
+#define IDE_PRD_END_OF_TABLE    0x8000
+#define IDE_PRD_BOUNDARY        0x10000
+#define IDE_PRD_TABLE_SIZE      32
+
+/**
+ * PhysicalRegionDescriptor - One scatter / gather entry for bus master DMA.
+ * Region must be physically contiguous and must not cross 64 KiB boundary
+ *
+ * @param physical_address Physical address of memory region, must be 2-bytes aligned
+ * @param byte_count       Region size in byte, 0 means 64 KiB
+ * @param flag             IDE_PRD_END_OF_TABLE for last entry in table
+ */
+struct PhysicalRegionDescriptor {
+    uint32_t physical_address;
+    uint16_t byte_count;
+    uint16_t flag;
+} __attribute__((packed));
+
+/**
+ * IDEDMADriverState - Contain all bus master IDE driver states
+ *
+ * @param bus_master_present Whether bus master IDE controller is found and enabled
+ * @param bus_master_base    I/O port base of primary channel bus master registers
+ * @param controller         PCI address of IDE controller
+ */
+struct IDEDMADriverState {
+    bool                    bus_master_present;
+    uint16_t                bus_master_base;
+    struct PCIDeviceAddress controller;
+} __attribute__((packed));
+
+
+
+/**
+ * Find PCI bus master IDE controller (ex: PIIX) and enable bus mastering
+ *
+ * @return True if DMA backend can be used
+ */
+bool initialize_ide_dma(void);
+
+/**
+ * Build PRD table for request segments and program bus master registers, but not starting the transfer yet.
+ * Segment virtual address is translated with currently active page directory
+ *
+ * @param segment       Memory segments of the request, transferred in order
+ * @param segment_count Amount of segment
+ * @param to_memory     True for device to memory (ATA read), false for memory to device (ATA write)
+ * @return              False if segments cannot be described with PRD table, caller should fallback to PIO
+ */
+bool ide_dma_prepare(const struct ATASegment *segment, uint8_t segment_count, bool to_memory);
+
+/**
+ * Start prepared bus master transfer, should be called right after ATA DMA command is issued.
+ * Completion is signaled with IRQ 14 or can be polled with ide_dma_is_done()
+ */
+void ide_dma_start(void);
+
+/**
+ * Check whether started bus master transfer already raise interrupt or error
+ *
+ * @return True if transfer is done and ide_dma_finish() can be called
+ */
+bool ide_dma_is_done(void);
+
+/**
+ * Stop bus master, acknowledge drive interrupt and clear bus master status
+ *
+ * @return True if transfer is completed without error
+ */
+bool ide_dma_finish(void);
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef _IOSTAT_H
+#define _IOSTAT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Block I/O statistics - request, block and cache hit counters with log2 latency histogram,
+ * broken down by which part of the file system issue the I/O
+ */
+
+// Latency bucket i count request taking [2^i, 2^(i+1)) TSC cycles
+#define IOSTAT_HISTOGRAM_BUCKET 32
+
+/**
+ * IOStatClass - Caller class of block I/O
+ *
+ * IOSTAT_CLASS_OTHER     - Boot sector, cache flush and anything untagged
+ * IOSTAT_CLASS_FAT       - FileAllocationTable cluster
+ * IOSTAT_CLASS_DIRECTORY - Directory table cluster
+ * IOSTAT_CLASS_DATA      - File content cluster
+ * IOSTAT_CLASS_JOURNAL   - Metadata journal log, superblock and checkpoint
+ */
+enum IOStatClass {
+    IOSTAT_CLASS_OTHER,
+    IOSTAT_CLASS_FAT,
+    IOSTAT_CLASS_DIRECTORY,
+    IOSTAT_CLASS_DATA,
+    IOSTAT_CLASS_JOURNAL,
+    IOSTAT_CLASS_COUNT,
+};
+
+/**
+ * IOStatClassStatistics - Counters of one caller class
+ *
+ * @param read_request   read_blocks() call
+ * @param write_request  write_blocks() call
+ * @param block_read     Block read from device
+ * @param block_written  Block written into device
+ * @param cache_hit      Cluster served by buffer cache without device I/O
+ * @param read_latency   Latency histogram of read_blocks()
+ * @param write_latency  Latency histogram of unplugged write_blocks(), plugged write only wait in plug list
+ */
+struct IOStatClassStatistics {
+    uint32_t read_request;
+    uint32_t write_request;
+    uint32_t block_read;
+    uint32_t block_written;
+    uint32_t cache_hit;
+    uint32_t read_latency[IOSTAT_HISTOGRAM_BUCKET];
+    uint32_t write_latency[IOSTAT_HISTOGRAM_BUCKET];
+} __attribute__((packed));
+
+/**
+ * IOStatistics - Block I/O statistics since boot
+ *
+ * @param class_statistics Counters of each IOStatClass
+ */
+struct IOStatistics {
+    struct IOStatClassStatistics class_statistics[IOSTAT_CLASS_COUNT];
+} __attribute__((packed));
+
+/**
+ * Read CPU time stamp counter
+ *
+ * @return Current TSC value
+ */
+uint64_t iostat_timestamp(void);
+
+/**
+ * Set caller class of following block I/O
+ *
+ * @param io_class New caller class
+ * @return         Previous caller class, for restoring afterward
+ */
+enum IOStatClass iostat_set_class(enum IOStatClass io_class);
+
+/**
+ * Get caller class of following block I/O
+ *
+ * @return Current caller class
+ */
+enum IOStatClass iostat_get_class(void);
+
+/**
+ * Account one block I/O into current caller class
+ *
+ * @param write       True for write_blocks(), false for read_blocks()
+ * @param block_count Transferred block
+ * @param cycles      Elapsed TSC cycles, 0 if request is only queued and not timed
+ */
+void iostat_record(bool write, uint32_t block_count, uint64_t cycles);
+
+/**
+ * Account buffer cache hit into current caller class
+ *
+ * @param cluster_count Cluster served from cache
+ */
+void iostat_record_cache_hit(uint32_t cluster_count);
+
+/**
+ * Copy block I/O statistics
+ *
+ * @param statistics Pointer for storing the counters
+ */
+void iostat_snapshot(struct IOStatistics *statistics);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef _PCI_H
+#define _PCI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* -- PCI configuration mechanism #1 ports -- */
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+#define PCI_CONFIG_ENABLE  0x80000000
+
+#define PCI_BUS_COUNT      256
+#define PCI_SLOT_COUNT     32
+#define PCI_FUNCTION_COUNT 8
+
+/* -- PCI configuration space register offset -- */
+#define PCI_REGISTER_VENDOR_ID 0x00
+#define PCI_REGISTER_COMMAND   0x04
+#define PCI_REGISTER_CLASS     0x08
+#define PCI_REGISTER_BAR4      0x20
+
+#define PCI_VENDOR_NONE        0xFFFF
+#define PCI_COMMAND_IO_SPACE   0x0001
+#define PCI_COMMAND_BUS_MASTER 0x0004
+#define PCI_BAR_IO_ADDRESS_MASK 0xFFFC
+
+/* -- PCI class code -- */
+#define PCI_CLASS_MASS_STORAGE   0x01
+#define PCI_SUBCLASS_IDE         0x01
+#define PCI_PROG_IF_BUS_MASTER   0x80
+
+/**
+ * PCIDeviceAddress - Location of a PCI function in configuration space
+ *
+ * @param bus      PCI bus number
+ * @param slot     Device number within the bus
+ * @param function Function number within the device
+ */
+struct PCIDeviceAddress {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t function;
+} __attribute__((packed));
+
+
+
+/**
+ * Read 32-bit register from PCI configuration space
+ *
+ * @param device Target PCI function
+ * @param offset Register offset, will be aligned down to 4 bytes
+ * @return       Register value
+ */
+uint32_t pci_config_read(struct PCIDeviceAddress device, uint8_t offset);
+
+/**
+ * Write 32-bit register into PCI configuration space
+ *
+ * @param device Target PCI function
+ * @param offset Register offset, will be aligned down to 4 bytes
+ * @param value  Value to write
+ */
+void pci_config_write(struct PCIDeviceAddress device, uint8_t offset, uint32_t value);
+
+/**
+ * Scan every bus, slot and function for the first device with matching class & subclass
+ *
+ * @param class_code Base class code, ex: PCI_CLASS_MASS_STORAGE
+ * @param subclass   Subclass code, ex: PCI_SUBCLASS_IDE
+ * @param result     Pointer for storing found device address
+ * @return           True if device is found
+ */
+bool pci_find_device_by_class(uint8_t class_code, uint8_t subclass, struct PCIDeviceAddress *result);
+
+#endif
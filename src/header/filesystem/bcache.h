@@ -0,0 +1,215 @@
+#ifndef _BCACHE_H
+#define _BCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fat32.h"
+
+/**
+ * Buffer cache - LRU cache of cluster sitting between FAT32 driver and block device.
+ * read_clusters() / write_clusters() go through this cache
+ */
+
+/* -- Buffer cache constants -- */
+// Maximum cached cluster, memory used is BCACHE_CAPACITY * CLUSTER_SIZE. Can be overridden at compile time
+#ifndef BCACHE_CAPACITY
+#define BCACHE_CAPACITY 32
+#endif
+
+#define BCACHE_HASH_SIZE 64
+#define BCACHE_NO_ENTRY  -1
+
+// Transfer larger than this amount of cluster is not filled into cache, so streaming file does not evict hot directory
+#define BCACHE_FILL_LIMIT (BCACHE_CAPACITY / 4)
+
+// Largest bcache_prefetch() request, prefetched cluster is staged in static buffer of this size
+#define BCACHE_PREFETCH_MAX BCACHE_FILL_LIMIT
+
+// bcache_writeback() write dirty cluster older than this many pass
+#define BCACHE_WRITEBACK_EXPIRE 6
+
+// Percentage of capacity, once this many cluster is dirty bcache_writeback() write every dirty cluster
+#define BCACHE_DIRTY_RATIO 50
+
+/**
+ * BufferCachePolicy - When written cluster reach the disk
+ *
+ * BCACHE_WRITE_THROUGH - write_clusters() update cache and write into disk immediately
+ * BCACHE_WRITE_BACK    - write_clusters() only update cache, dirty cluster written on eviction or bcache_flush()
+ */
+enum BufferCachePolicy
+{
+    BCACHE_WRITE_THROUGH,
+    BCACHE_WRITE_BACK,
+};
+
+/**
+ * BufferCacheEntry - One cached cluster
+ *
+ * @param data           Cached cluster content
+ * @param cluster_number Cluster number of cached content
+ * @param valid          Whether this entry hold any cluster
+ * @param dirty          Content is newer than disk, only used in BCACHE_WRITE_BACK
+ * @param prefetched     Filled by bcache_prefetch() and not yet used
+ * @param dirty_epoch    bcache_writeback() pass count when entry became dirty
+ * @param lru_prev       More recently used entry index, BCACHE_NO_ENTRY for most recently used
+ * @param lru_next       Less recently used entry index, BCACHE_NO_ENTRY for least recently used
+ * @param hash_next      Next entry index in the same hash bucket
+ */
+struct BufferCacheEntry
+{
+    struct ClusterBuffer data;
+    uint32_t cluster_number;
+    bool valid;
+    bool dirty;
+    bool prefetched;
+    uint32_t dirty_epoch;
+    int16_t lru_prev;
+    int16_t lru_next;
+    int16_t hash_next;
+};
+
+/**
+ * BufferCacheStatistics - Buffer cache counters since initialize_buffer_cache()
+ *
+ * @param hit          Cluster served from cache
+ * @param miss         Cluster read from disk
+ * @param eviction     Valid entry reused for other cluster
+ * @param write_back   Dirty cluster written into disk
+ * @param prefetch     Cluster read from disk by bcache_prefetch()
+ * @param prefetch_hit Prefetched cluster later used by bcache_read()
+ * @param discard      Dirty cluster dropped without writing because it was freed
+ */
+struct BufferCacheStatistics
+{
+    uint32_t hit;
+    uint32_t miss;
+    uint32_t eviction;
+    uint32_t write_back;
+    uint32_t prefetch;
+    uint32_t prefetch_hit;
+    uint32_t discard;
+} __attribute__((packed));
+
+/**
+ * BufferCacheState - Contain all buffer cache states
+ *
+ * @param entry      Cache entries, only first capacity entries are used
+ * @param hash_head  First entry index of each hash bucket, keyed by cluster number
+ * @param lru_head   Most recently used entry index
+ * @param lru_tail   Least recently used entry index, invalid entries are always kept at tail
+ * @param capacity   Amount of used entry, at most BCACHE_CAPACITY
+ * @param policy     Current write policy
+ * @param epoch      Amount of bcache_writeback() pass, age of dirty entry
+ * @param statistics Counters
+ */
+struct BufferCacheState
+{
+    struct BufferCacheEntry entry[BCACHE_CAPACITY];
+    int16_t hash_head[BCACHE_HASH_SIZE];
+    int16_t lru_head;
+    int16_t lru_tail;
+    uint16_t capacity;
+    enum BufferCachePolicy policy;
+    uint32_t epoch;
+    struct BufferCacheStatistics statistics;
+};
+
+/**
+ * Initialize empty buffer cache with BCACHE_CAPACITY entries and BCACHE_WRITE_THROUGH policy.
+ * Called by initialize_filesystem_fat32()
+ */
+void initialize_buffer_cache(void);
+
+/**
+ * Change cache size and write policy. Dirty cluster is flushed and every entry is dropped
+ *
+ * @param capacity Amount of entry to use, clamped into 1 - BCACHE_CAPACITY
+ * @param policy   New write policy
+ */
+void bcache_configure(uint16_t capacity, enum BufferCachePolicy policy);
+
+/**
+ * Get current write policy
+ *
+ * @return Write policy set by initialize_buffer_cache() or bcache_configure()
+ */
+enum BufferCachePolicy bcache_get_policy(void);
+
+/**
+ * Read clusters, cached cluster is copied from memory and consecutive missing clusters are read with one block request
+ *
+ * @param ptr            Pointer to buffer for reading
+ * @param cluster_number First cluster number to read
+ * @param cluster_count  Cluster count to read
+ */
+void bcache_read(void *ptr, uint32_t cluster_number, uint32_t cluster_count);
+
+/**
+ * Check whether cluster is currently cached
+ *
+ * @param cluster_number Cluster number to check
+ * @return               True if bcache_read() of this cluster will not touch disk
+ */
+bool bcache_contains(uint32_t cluster_number);
+
+/**
+ * Fill cache with clusters ahead of use without copying into caller,
+ * consecutive missing clusters are read with one block request.
+ * Prefetched cluster enter at least recently used end and is promoted only when bcache_read() use it
+ *
+ * @param cluster_number First cluster number to prefetch
+ * @param cluster_count  Cluster count to prefetch, clamped into BCACHE_PREFETCH_MAX
+ */
+void bcache_prefetch(uint32_t cluster_number, uint32_t cluster_count);
+
+/**
+ * Write clusters into cache, and into disk depending on policy.
+ * Same as write_blocks(), ptr must stay valid until disk_unplug() if called inside plugged section
+ *
+ * @param ptr            Pointer to source data
+ * @param cluster_number First cluster number to write
+ * @param cluster_count  Cluster count to write
+ */
+void bcache_write(const void *ptr, uint32_t cluster_number, uint32_t cluster_count);
+
+/**
+ * Update cached clusters without writing into disk regardless of policy, entry is left clean.
+ * Used for cluster whose disk write is owned by metadata journal
+ *
+ * @param ptr            Pointer to source data
+ * @param cluster_number First cluster number to store
+ * @param cluster_count  Cluster count to store
+ */
+void bcache_store(const void *ptr, uint32_t cluster_number, uint32_t cluster_count);
+
+/**
+ * Forget cached clusters without writing them, used when clusters are freed.
+ * Content written and freed before reaching disk never cost any I/O
+ *
+ * @param cluster_number First cluster number to drop
+ * @param cluster_count  Cluster count to drop
+ */
+void bcache_discard(uint32_t cluster_number, uint32_t cluster_count);
+
+/**
+ * Write every dirty cluster into disk, sorted and merged by I/O scheduler. Will blocking until all is written
+ */
+void bcache_flush(void);
+
+/**
+ * One periodic write-back pass. Dirty cluster older than BCACHE_WRITEBACK_EXPIRE pass is written,
+ * or every dirty cluster once BCACHE_DIRTY_RATIO of cache is dirty
+ *
+ * @return Amount of cluster written
+ */
+uint32_t bcache_writeback(void);
+
+/**
+ * Copy buffer cache counters
+ *
+ * @param statistics Pointer for storing the counters
+ */
+void bcache_statistics(struct BufferCacheStatistics *statistics);
+
+#endif
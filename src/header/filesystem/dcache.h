@@ -0,0 +1,130 @@
+#ifndef _DCACHE_H
+#define _DCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fat32.h"
+
+/**
+ * Dentry cache - Result of recent name lookup, keyed by parent directory cluster, name and extension.
+ * Used by resolve_path(), name that does not exist is cached too so repeated miss need no disk read.
+ * FAT32 driver invalidate the entry on every write / delete / move touching the name
+ */
+
+/* -- Dentry cache constants -- */
+// Maximum cached lookup, can be overridden at compile time
+#ifndef DCACHE_CAPACITY
+#define DCACHE_CAPACITY 256
+#endif
+
+#define DCACHE_HASH_SIZE 128
+#define DCACHE_NO_ENTRY  -1
+
+/**
+ * DentryCacheEntry - One cached lookup result
+ *
+ * @param parent_cluster_number First cluster of directory searched
+ * @param name                  Looked up name
+ * @param ext                   Looked up extension
+ * @param valid                 Whether this entry hold any lookup
+ * @param negative              Name does not exist in parent directory
+ * @param attribute             Attribute of found entry
+ * @param cluster_number        First cluster of found entry
+ * @param last_used             Cache access counter value at last use, least value is evicted first
+ * @param hash_next             Next entry index in the same hash bucket
+ */
+struct DentryCacheEntry
+{
+    uint32_t parent_cluster_number;
+    char name[8];
+    char ext[3];
+    bool valid;
+    bool negative;
+    uint8_t attribute;
+    uint32_t cluster_number;
+    uint32_t last_used;
+    int16_t hash_next;
+};
+
+/**
+ * DentryCacheStatistics - Dentry cache counters since initialize_dentry_cache()
+ *
+ * @param hit          Lookup answered with existing entry
+ * @param negative_hit Lookup answered with cached "does not exist"
+ * @param miss         Lookup that need directory search
+ * @param invalidation Entry removed because directory content changed
+ */
+struct DentryCacheStatistics
+{
+    uint32_t hit;
+    uint32_t negative_hit;
+    uint32_t miss;
+    uint32_t invalidation;
+} __attribute__((packed));
+
+/**
+ * DentryCacheState - Contain all dentry cache states
+ *
+ * @param entry      Cache entries
+ * @param hash_head  First entry index of each hash bucket, keyed by parent cluster, name and extension
+ * @param clock      Access counter for LRU
+ * @param statistics Counters
+ */
+struct DentryCacheState
+{
+    struct DentryCacheEntry entry[DCACHE_CAPACITY];
+    int16_t hash_head[DCACHE_HASH_SIZE];
+    uint32_t clock;
+    struct DentryCacheStatistics statistics;
+};
+
+/**
+ * Drop every cached lookup, called by initialize_filesystem_fat32()
+ */
+void initialize_dentry_cache(void);
+
+/**
+ * Find cached lookup result and mark it most recently used
+ *
+ * @param parent_cluster_number First cluster of directory
+ * @param name                  8-byte entry name
+ * @param ext                   3-byte entry extension
+ * @return                      Cached entry, check negative field. NULL if lookup is not cached
+ */
+struct DentryCacheEntry *dcache_lookup(uint32_t parent_cluster_number, const char *name, const char *ext);
+
+/**
+ * Cache lookup result, replacing older result of the same name. Least recently used entry is evicted if needed
+ *
+ * @param parent_cluster_number First cluster of directory
+ * @param name                  8-byte entry name
+ * @param ext                   3-byte entry extension
+ * @param entry                 Found directory entry, NULL to cache "does not exist"
+ * @return                      Cached entry
+ */
+struct DentryCacheEntry *dcache_insert(uint32_t parent_cluster_number, const char *name, const char *ext, const struct FAT32DirectoryEntry *entry);
+
+/**
+ * Forget cached lookup of one name
+ *
+ * @param parent_cluster_number First cluster of directory
+ * @param name                  8-byte entry name
+ * @param ext                   3-byte entry extension
+ */
+void dcache_invalidate(uint32_t parent_cluster_number, const char *name, const char *ext);
+
+/**
+ * Forget every cached lookup inside directory, used when directory is deleted or modified directly
+ *
+ * @param parent_cluster_number First cluster of directory
+ */
+void dcache_invalidate_directory(uint32_t parent_cluster_number);
+
+/**
+ * Copy dentry cache counters
+ *
+ * @param statistics Pointer for storing the counters
+ */
+void dcache_statistics(struct DentryCacheStatistics *statistics);
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef _DIRINDEX_H
+#define _DIRINDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fat32.h"
+
+/**
+ * Directory index - In-memory hash index of recently used directories, name + extension to entry slot.
+ * Built by FAT32 driver on first lookup of a directory and kept up to date by write / delete / move
+ */
+
+/* -- Directory index constants -- */
+// Indexed directory and total indexed entry, memory is fixed regardless of directory size
+#define DIRINDEX_DIRECTORY_COUNT 16
+#define DIRINDEX_NODE_COUNT      4096
+
+#define DIRINDEX_HASH_SIZE 1024
+#define DIRINDEX_NO_NODE   -1
+
+/**
+ * DirectoryIndexNode - One indexed directory entry
+ *
+ * @param name           Entry name
+ * @param ext            Entry extension
+ * @param directory      Owning DirectoryIndex position in index state
+ * @param slot_index     Slot index of entry inside slot_cluster
+ * @param slot_cluster   Directory cluster containing the entry
+ * @param first_cluster  First cluster of entry content
+ * @param hash_next      Next node index in the same hash bucket
+ * @param directory_prev Previous node index of the same directory
+ * @param directory_next Next node index of the same directory, or next free node
+ */
+struct DirectoryIndexNode
+{
+    char name[8];
+    char ext[3];
+    uint8_t directory;
+    uint16_t slot_index;
+    uint32_t slot_cluster;
+    uint32_t first_cluster;
+    int16_t hash_next;
+    int16_t directory_prev;
+    int16_t directory_next;
+};
+
+/**
+ * DirectoryIndex - Index record of one directory
+ *
+ * @param dir_cluster       First cluster of indexed directory
+ * @param valid             Whether this record hold any directory
+ * @param last_used         Index access counter value at last use, least value is evicted first
+ * @param node_head         First node of this directory
+ * @param node_count        Amount of used entry in directory
+ * @param free_slot_count   Amount of free slot in directory
+ * @param free_slot_cluster Directory cluster where free slot search start
+ * @param last_cluster      Last cluster of directory chain, where directory grow
+ */
+struct DirectoryIndex
+{
+    uint32_t dir_cluster;
+    bool valid;
+    uint32_t last_used;
+    int16_t node_head;
+    uint16_t node_count;
+    uint32_t free_slot_count;
+    uint32_t free_slot_cluster;
+    uint32_t last_cluster;
+};
+
+/**
+ * DirectoryIndexState - Contain all directory index states
+ *
+ * @param directory  Index record of each indexed directory
+ * @param node       Node pool shared by every directory
+ * @param hash_head  First node index of each hash bucket, keyed by directory cluster, name and extension
+ * @param free_node  First unused node index
+ * @param clock      Access counter for directory LRU
+ */
+struct DirectoryIndexState
+{
+    struct DirectoryIndex directory[DIRINDEX_DIRECTORY_COUNT];
+    struct DirectoryIndexNode node[DIRINDEX_NODE_COUNT];
+    int16_t hash_head[DIRINDEX_HASH_SIZE];
+    int16_t free_node;
+    uint32_t clock;
+};
+
+/**
+ * Drop every index, called by initialize_filesystem_fat32()
+ */
+void initialize_directory_index(void);
+
+/**
+ * Get index of directory and mark it most recently used
+ *
+ * @param dir_cluster First cluster of directory
+ * @return            Index record, NULL if directory is not indexed
+ */
+struct DirectoryIndex *dirindex_get(uint32_t dir_cluster);
+
+/**
+ * Start empty index of directory, least recently used directory index is evicted if needed.
+ * Caller fill it with dirindex_insert() and set free slot / last cluster field
+ *
+ * @param dir_cluster First cluster of directory
+ * @return            Empty index record
+ */
+struct DirectoryIndex *dirindex_create(uint32_t dir_cluster);
+
+/**
+ * Add entry into directory index. When node pool is exhausted, other directory index is evicted
+ *
+ * @param directory    Index record
+ * @param entry        Directory entry to add
+ * @param slot_cluster Directory cluster containing the entry
+ * @param slot_index   Slot index of entry inside slot_cluster
+ * @return             False if directory alone exhaust node pool, caller must dirindex_drop() it
+ */
+bool dirindex_insert(struct DirectoryIndex *directory, const struct FAT32DirectoryEntry *entry, uint32_t slot_cluster, uint16_t slot_index);
+
+/**
+ * Find entry in directory index
+ *
+ * @param directory Index record
+ * @param name      8-byte entry name
+ * @param ext       3-byte entry extension
+ * @return          Node of entry, NULL if directory has no such entry
+ */
+struct DirectoryIndexNode *dirindex_lookup(struct DirectoryIndex *directory, const char *name, const char *ext);
+
+/**
+ * Remove entry from directory index
+ *
+ * @param directory Index record
+ * @param name      8-byte entry name
+ * @param ext       3-byte entry extension
+ */
+void dirindex_remove(struct DirectoryIndex *directory, const char *name, const char *ext);
+
+/**
+ * Forget index of directory, used when directory is deleted or modified without updating the index
+ *
+ * @param dir_cluster First cluster of directory
+ */
+void dirindex_drop(uint32_t dir_cluster);
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef _EXTCACHE_H
+#define _EXTCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "fat32.h"
+
+/**
+ * Extent cache - Cluster chain of recently seeked files compressed into contiguous runs, keyed by first cluster.
+ * Built lazily up to the cluster being looked up, so seeking into a large file is a binary search over runs
+ * instead of a walk over every FAT entry. FAT32 driver report every chain change of a file
+ */
+
+/* -- Extent cache constants -- */
+// Cached file and run per file, chain with more run is cached up to the last run and walked past it
+#define EXTCACHE_FILE_COUNT   16
+#define EXTCACHE_EXTENT_COUNT 64
+
+/**
+ * FileExtent - Contiguous run of a file cluster chain
+ *
+ * @param logical_start  Cluster index inside the file of first cluster in run
+ * @param physical_start Cluster number of first cluster in run
+ * @param length         Cluster count in run
+ */
+struct FileExtent
+{
+    uint32_t logical_start;
+    uint32_t physical_start;
+    uint32_t length;
+};
+
+/**
+ * FileExtentMap - Known part of one file cluster chain
+ *
+ * @param first_cluster First cluster of the file
+ * @param valid         Whether this map hold any file
+ * @param complete      Last run end at end of chain
+ * @param last_used     Cache access counter value at last use, least value is evicted first
+ * @param extent_count  Amount of run known
+ * @param extent        Runs ordered by logical_start, covering the chain from its first cluster
+ */
+struct FileExtentMap
+{
+    uint32_t first_cluster;
+    bool valid;
+    bool complete;
+    uint32_t last_used;
+    uint16_t extent_count;
+    struct FileExtent extent[EXTCACHE_EXTENT_COUNT];
+};
+
+/**
+ * ExtentCacheStatistics - Extent cache counters since initialize_extent_cache()
+ *
+ * @param hit          Lookup answered from known run
+ * @param miss         Lookup that need the chain walked further
+ * @param walked       FAT entry read while building run or walking past full map
+ * @param invalidation Map dropped because chain changed
+ */
+struct ExtentCacheStatistics
+{
+    uint32_t hit;
+    uint32_t miss;
+    uint32_t walked;
+    uint32_t invalidation;
+} __attribute__((packed));
+
+/**
+ * ExtentCacheState - Contain all extent cache states
+ *
+ * @param map        Cached chain of each file
+ * @param clock      Access counter for LRU
+ * @param statistics Counters
+ */
+struct ExtentCacheState
+{
+    struct FileExtentMap map[EXTCACHE_FILE_COUNT];
+    uint32_t clock;
+    struct ExtentCacheStatistics statistics;
+};
+
+/**
+ * Drop every cached chain, called by initialize_filesystem_fat32()
+ */
+void initialize_extent_cache(void);
+
+/**
+ * Map cluster index of a file into cluster number, chain is walked only past the known runs
+ *
+ * @param first_cluster First cluster of the file
+ * @param cluster_index Cluster index inside the file, 0 is first cluster
+ * @return              Cluster number, FAT32_FAT_END_OF_FILE if chain is shorter
+ */
+uint32_t extcache_map(uint32_t first_cluster, uint32_t cluster_index);
+
+/**
+ * Report chain that grew at its end, known run is kept and the new tail is walked on next lookup
+ *
+ * @param first_cluster First cluster of the file
+ */
+void extcache_grow(uint32_t first_cluster);
+
+/**
+ * Forget cached chain, used when chain is truncated or freed
+ *
+ * @param first_cluster First cluster of the file
+ */
+void extcache_invalidate(uint32_t first_cluster);
+
+/**
+ * Copy extent cache counters
+ *
+ * @param statistics Pointer for storing the counters
+ */
+void extcache_statistics(struct ExtentCacheStatistics *statistics);
+
+#endif
@@ -14,6 +14,7 @@
 #define BOOT_SECTOR 0
 #define CLUSTER_BLOCK_COUNT 4
 #define CLUSTER_SIZE (BLOCK_SIZE * CLUSTER_BLOCK_COUNT)
+// Entry count of single-cluster FAT, used by volume formatted without FAT32InfoSector
 #define CLUSTER_MAP_SIZE 512
 
 /* -- FAT32 FileAllocationTable constants -- */
@@ -28,13 +29,75 @@
 #define FAT_CLUSTER_NUMBER 1
 #define ROOT_CLUSTER_NUMBER 2
 
+/* -- FAT32 volume geometry constants -- */
+// Volume geometry is stored right after boot sector, FAT start at cluster 1 and span as many cluster as needed
+#define FAT32_INFO_SECTOR 1
+#define FAT32_FAT_LBA     (FAT_CLUSTER_NUMBER * CLUSTER_BLOCK_COUNT)
+
+// Largest volume supported, 512 MiB of data cluster. Bigger disk is formatted up to this size
+#define FAT32_MAX_CLUSTER_COUNT (256 * 1024)
+
+// FileAllocationTable is loaded and flushed per sector, only sector containing modified entry is written
+#define FAT32_FAT_ENTRY_PER_SECTOR (BLOCK_SIZE / sizeof(uint32_t))
+
+// Amount of FAT sector kept in memory, can be overridden at compile time
+#ifndef FAT32_FAT_CACHE_SIZE
+#define FAT32_FAT_CACHE_SIZE 16
+#endif
+
+/* -- FAT32 journal constants -- */
+// Metadata journal region placed between FAT and cluster 2, volume on smaller disk is created without journal
+#define FAT32_JOURNAL_BLOCK_COUNT    256
+#define FAT32_JOURNAL_MIN_DISK_BLOCK (FAT32_JOURNAL_BLOCK_COUNT * 16)
+
+/* -- FAT32 background flusher constants -- */
+// Timer tick between two flusher pass in BCACHE_WRITE_BACK, timer tick every 1 ms
+#define FAT32_FLUSH_INTERVAL 500
+
+/* -- FAT32 cluster allocator constants -- */
+// One bit per cluster in FileAllocationTable, bit set means cluster is in use
+#define FAT32_ALLOCATOR_BITMAP_WORD (FAT32_MAX_CLUSTER_COUNT / 32)
+// First cluster that can be handed out, cluster 0 - 2 are reserved and root
+#define FAT32_ALLOCATOR_FIRST_CLUSTER 3
+
+// Growing file reserve this many free cluster for its next growth, so interleaved append of many file stay contiguous
+#define FAT32_RESERVATION_WINDOW 8
+// Amount of file holding reservation at once, least recently grown file lose its reservation first
+#define FAT32_RESERVATION_COUNT 8
+
+/* -- FAT32 readahead constants -- */
+// Readahead window in cluster, doubled on every sequential hop until maximum
+#define FAT32_READAHEAD_MIN_WINDOW 2
+#define FAT32_READAHEAD_MAX_WINDOW 8
+
+/* -- FAT32 search constants -- */
+// Text file is searched through fixed size chunk read with pread(), instead of whole file at once
+#define FAT32_SEARCH_CHUNK_SIZE CLUSTER_SIZE
+
+// copy_file() move content through kernel buffer this many cluster at a time
+#define FAT32_COPY_BATCH 8
+
+// Open file table size, every descriptor of the same file share one record
+#define FAT32_OPEN_FILE_COUNT 32
+
+// file_seek() origin
+#define FAT32_SEEK_SET 0
+#define FAT32_SEEK_CUR 1
+#define FAT32_SEEK_END 2
+
 /* -- FAT32 DirectoryEntry constants -- */
 #define ATTR_SUBDIRECTORY 0b00010000
 #define UATTR_NOT_EMPTY 0b10101010
 
+// DirectoryEntry slot per directory cluster. Directory is a cluster chain, slot 0 of first cluster is entry about itself
+#define FAT32_DIRECTORY_ENTRY_COUNT (CLUSTER_SIZE / 32)
+
 // Boot sector signature for this file system "FAT32 - IF2230 edition"
 extern const uint8_t fs_signature[BLOCK_SIZE];
 
+// FAT32InfoSector signature, volume without it use single-cluster FAT geometry
+#define FAT32_INFO_SIGNATURE "IF2230GE"
+
 // Cluster buffer data type - @param buf Byte buffer with size of CLUSTER_SIZE
 struct ClusterBuffer
 {
@@ -44,13 +107,52 @@ struct ClusterBuffer
 /* -- FAT32 Data Structures -- */
 
 /**
- * FAT32 FileAllocationTable, for more information about this, check guidebook
+ * FAT32InfoSector - Volume geometry written by create_fat32(), located at FAT32_INFO_SECTOR
  *
- * @param cluster_map Containing cluster map of FAT32
+ * @param signature           FAT32_INFO_SIGNATURE
+ * @param cluster_count       FAT entry count, including reserved cluster 0 and 1
+ * @param fat_block_count     Block used by FAT starting from FAT32_FAT_LBA, multiple of CLUSTER_BLOCK_COUNT
+ * @param data_lba            Logical block address of cluster 2 (root)
+ * @param journal_lba         Logical block address of metadata journal region, right after FAT
+ * @param journal_block_count Journal region size, 0 if volume has no journal
  */
-struct FAT32FileAllocationTable
+struct FAT32InfoSector
 {
-    uint32_t cluster_map[CLUSTER_MAP_SIZE];
+    char signature[8];
+    uint32_t cluster_count;
+    uint32_t fat_block_count;
+    uint32_t data_lba;
+    uint32_t journal_lba;
+    uint32_t journal_block_count;
+    uint8_t reserved[BLOCK_SIZE - 28];
+} __attribute__((packed));
+
+/**
+ * FAT32 FileAllocationTable sector, for more information about FAT, check guidebook
+ *
+ * @param cluster_map Containing FAT32_FAT_ENTRY_PER_SECTOR entries of cluster map
+ */
+struct FAT32FileAllocationTableSector
+{
+    uint32_t cluster_map[FAT32_FAT_ENTRY_PER_SECTOR];
+} __attribute__((packed));
+
+/**
+ * FAT32FatCacheEntry - One FAT sector kept in memory
+ *
+ * @param data      Cached FAT sector content
+ * @param sector    Sector index relative to FAT32_FAT_LBA
+ * @param last_used FAT32DriverState fat_cache_clock value at last access, least value is evicted first
+ * @param valid     Whether this entry hold any sector
+ * @param dirty     Content is newer than disk, written on eviction or flush_fat()
+ */
+struct FAT32FatCacheEntry
+{
+    struct FAT32FileAllocationTableSector data;
+    uint32_t sector;
+    uint32_t last_used;
+    bool valid;
+    bool dirty;
 } __attribute__((packed));
 
 /**
@@ -92,28 +194,104 @@ struct FAT32DirectoryEntry
     uint32_t filesize;
 } __attribute__((packed));
 
-// FAT32 DirectoryTable, containing directory entry table - @param table Table of DirectoryEntry that span within 1 cluster
+// FAT32 DirectoryTable, one cluster of directory chain - @param table Table of DirectoryEntry that span within 1 cluster
 struct FAT32DirectoryTable
 {
-    struct FAT32DirectoryEntry table[CLUSTER_SIZE / sizeof(struct FAT32DirectoryEntry)];
+    struct FAT32DirectoryEntry table[FAT32_DIRECTORY_ENTRY_COUNT];
 } __attribute__((packed));
 
 /* -- FAT32 Driver -- */
 
+/**
+ * FAT32ClusterAllocator - Free cluster tracking, kept consistent with FileAllocationTable by fat_set()
+ *
+ * @param used_bitmap    Bit per cluster, set if FAT entry is not FAT32_FAT_EMPTY_ENTRY, cluster is reserved or pending
+ * @param pending_bitmap Bit per cluster freed by running journal transaction, kept used until the transaction is committed
+ *                       so its content cannot be overwritten while committed metadata may still point to it
+ * @param free_count     Amount of free cluster, reserved and pending cluster is not free
+ * @param next_hint      Cluster where next search start, rotated past every allocation (next-fit)
+ * @param reserved_count Amount of cluster held by FAT32Reservation
+ * @param pending_count  Amount of cluster set in pending_bitmap
+ */
+struct FAT32ClusterAllocator
+{
+    uint32_t used_bitmap[FAT32_ALLOCATOR_BITMAP_WORD];
+    uint32_t pending_bitmap[FAT32_ALLOCATOR_BITMAP_WORD];
+    uint32_t free_count;
+    uint32_t next_hint;
+    uint32_t reserved_count;
+    uint32_t pending_count;
+};
+
+/**
+ * FAT32Reservation - Free cluster run held back for next growth of one file. Reserved cluster is marked
+ * used in allocator but stay FAT32_FAT_EMPTY_ENTRY in FAT, so it cost no disk write and vanish on remount
+ *
+ * @param first_cluster First cluster of owning file, 0 if unused
+ * @param start         First reserved cluster
+ * @param count         Amount of reserved cluster left
+ * @param last_used     Reservation clock value at last growth, least value is released first
+ */
+struct FAT32Reservation
+{
+    uint32_t first_cluster;
+    uint32_t start;
+    uint32_t count;
+    uint32_t last_used;
+};
+
+/**
+ * FAT32Readahead - Readahead state of one sequential cluster chain walk
+ *
+ * @param expected_cluster Next cluster in chain after the last access, sequential if next access hit this
+ * @param window           Current readahead window in cluster
+ * @param last_cluster     Last accessed cluster, accessing it again is not a hop
+ */
+struct FAT32Readahead
+{
+    uint32_t expected_cluster;
+    uint32_t window;
+    uint32_t last_cluster;
+};
+
 /**
  * FAT32DriverState - Contain all driver states
  *
- * @param fat_table     FAT of the system, will be loaded during initialize_filesystem_fat32()
- * @param dir_table_buf Buffer for directory table
- * @param cluster_buf   Buffer for cluster, can be used for temp var
+ * @param fat_cache       FAT sectors loaded on demand by fat_get() / fat_set()
+ * @param fat_cache_clock Access counter for FAT sector LRU
+ * @param dir_table_buf   Buffer for directory table
+ * @param cluster_buf     Buffer for cluster, can be used for temp var
+ * @param cluster_count   FAT entry count of mounted volume
+ * @param fat_block_count Block used by FAT of mounted volume
+ * @param data_lba        Logical block address of cluster 2 in mounted volume
  */
 struct FAT32DriverState
 {
-    struct FAT32FileAllocationTable fat_table;
+    struct FAT32FatCacheEntry fat_cache[FAT32_FAT_CACHE_SIZE];
+    uint32_t fat_cache_clock;
     struct FAT32DirectoryTable dir_table_buf;
     struct ClusterBuffer cluster_buf;
+    uint32_t cluster_count;
+    uint32_t fat_block_count;
+    uint32_t data_lba;
 } __attribute__((packed));
 
+/**
+ * FAT32DirectoryIterator - Lazy walk over every cluster of a directory, next cluster is read only when reached
+ *
+ * @param table          Content of current directory cluster
+ * @param cluster_number Current directory cluster number
+ * @param entry_index    Next slot index to visit in table
+ * @param readahead      Readahead state of the cluster chain walk
+ */
+struct FAT32DirectoryIterator
+{
+    struct FAT32DirectoryTable table;
+    uint32_t cluster_number;
+    uint32_t entry_index;
+    struct FAT32Readahead readahead;
+};
+
 /**
  * FAT32DriverRequest - Request for Driver CRUD operation
  *
@@ -132,9 +310,132 @@ struct FAT32DriverRequest
     uint32_t buffer_size;
 } __attribute__((packed));
 
+/**
+ * FAT32PathRequest - Request for resolve_path()
+ *
+ * @param path               Null-terminated path, "/" separated. Absolute path start from root, "." and ".." allowed
+ * @param cwd_cluster_number Directory cluster where relative path start
+ */
+struct FAT32PathRequest
+{
+    const char *path;
+    uint32_t cwd_cluster_number;
+} __attribute__((packed));
+
+/**
+ * FAT32ResolvedPath - Result of resolve_path()
+ *
+ * @param parent_cluster_number Directory cluster containing last path component
+ * @param cluster_number        First cluster of last path component, 0 if it does not exist
+ * @param name                  Name of last path component
+ * @param ext                   Extension of last path component
+ * @param is_directory          Whether last path component is a directory
+ */
+struct FAT32ResolvedPath
+{
+    uint32_t parent_cluster_number;
+    uint32_t cluster_number;
+    char name[8];
+    char ext[3];
+    bool is_directory;
+} __attribute__((packed));
+
+/**
+ * FAT32FileRange - Position of pread() / pwrite()
+ *
+ * @param offset      Byte offset inside the file where transfer start
+ * @param transferred Byte count actually transferred, set by pread() / pwrite()
+ */
+struct FAT32FileRange
+{
+    uint32_t offset;
+    uint32_t transferred;
+} __attribute__((packed));
+
+/**
+ * FAT32OpenFile - Open file table record, shared by every descriptor of the same file
+ *
+ * @param entry_cluster   Directory cluster containing the file entry, 0 if file was deleted while open
+ * @param entry_index     Slot index of file entry inside entry_cluster
+ * @param first_cluster   First cluster of file content
+ * @param filesize        Current file size
+ * @param reference_count Amount of descriptor using this record, 0 if record is unused
+ * @param generation      Increased when tail of chain is freed, cursor of older generation is discarded
+ */
+struct FAT32OpenFile
+{
+    uint32_t entry_cluster;
+    uint32_t entry_index;
+    uint32_t first_cluster;
+    uint32_t filesize;
+    uint32_t reference_count;
+    uint32_t generation;
+};
+
+/**
+ * FAT32FileCursor - Known position on cluster chain of a file, chain walk start here instead of first cluster
+ *
+ * @param cluster_index  Cluster index inside the file
+ * @param cluster_number Cluster number at cluster_index, 0 if cursor is unset
+ * @param generation     FAT32OpenFile generation when cursor was set
+ */
+struct FAT32FileCursor
+{
+    uint32_t cluster_index;
+    uint32_t cluster_number;
+    uint32_t generation;
+};
+
+/**
+ * FAT32FileDescriptor - Per-process handle of an open file
+ *
+ * @param used      Whether descriptor hold an open file
+ * @param open_file Index of record in open file table
+ * @param offset    Byte offset of next file_read() / file_write()
+ * @param cursor    Last cluster accessed through this descriptor
+ */
+struct FAT32FileDescriptor
+{
+    bool used;
+    int16_t open_file;
+    uint32_t offset;
+    struct FAT32FileCursor cursor;
+};
+
+/**
+ * FAT32FileRequest - Request for read / write through file descriptor syscall
+ *
+ * @param fd          File descriptor returned by open syscall
+ * @param buf         Source or destination buffer
+ * @param count       Byte count to transfer
+ * @param transferred Byte count actually transferred, set by kernel
+ */
+struct FAT32FileRequest
+{
+    int32_t fd;
+    void *buf;
+    uint32_t count;
+    uint32_t transferred;
+} __attribute__((packed));
+
+/**
+ * FAT32SeekRequest - Request for seek syscall
+ *
+ * @param fd       File descriptor returned by open syscall
+ * @param offset   Byte offset relative to whence
+ * @param whence   FAT32_SEEK_SET, FAT32_SEEK_CUR or FAT32_SEEK_END
+ * @param position New byte offset from start of file, set by kernel
+ */
+struct FAT32SeekRequest
+{
+    int32_t fd;
+    int32_t offset;
+    uint8_t whence;
+    uint32_t position;
+} __attribute__((packed));
+
 uint32_t move_to_child_directory(struct FAT32DriverRequest request);
 uint32_t move_to_parent_directory(struct FAT32DriverRequest request);
-uint32_t move_dir(struct FAT32DriverRequest src_req, struct FAT32DriverRequest dest_req);
 
 /* -- Driver Interfaces -- */
 
@@ -157,6 +458,53 @@ uint32_t cluster_to_lba(uint32_t cluster);
  */
 void init_directory_table(struct FAT32DirectoryTable *dir_table, char *name, uint32_t parent_dir_cluster);
 
+/**
+ * Start directory walk from first cluster of directory, slot 0 (entry about itself) is skipped.
+ * Entry returned by iterator point into iterator table, modification is written with
+ * write_clusters(&iterator->table, iterator->cluster_number, 1)
+ *
+ * @param iterator           Iterator to initialize
+ * @param dir_cluster_number First cluster of directory
+ * @return                   False if cluster is not a directory, iterator must not be used
+ */
+bool dir_iterator_open(struct FAT32DirectoryIterator *iterator, uint32_t dir_cluster_number);
+
+/**
+ * Get next slot of directory, used or free. Slot index in current cluster is iterator->entry_index - 1
+ *
+ * @param iterator Opened iterator
+ * @return         Pointer to slot, NULL after last cluster
+ */
+struct FAT32DirectoryEntry *dir_iterator_next_slot(struct FAT32DirectoryIterator *iterator);
+
+/**
+ * Get next used entry of directory
+ *
+ * @param iterator Opened iterator
+ * @return         Pointer to entry, NULL after last cluster
+ */
+struct FAT32DirectoryEntry *dir_iterator_next(struct FAT32DirectoryIterator *iterator);
+
+/**
+ * Continue directory walk until used entry with matching name and extension
+ *
+ * @param iterator Opened iterator
+ * @param name     8-byte entry name
+ * @param ext      3-byte entry extension
+ * @return         Pointer to entry, NULL if not found
+ */
+struct FAT32DirectoryEntry *dir_iterator_find(struct FAT32DirectoryIterator *iterator, const char *name, const char *ext);
+
+/**
+ * Find used entry with matching name and extension through directory index, index is built on first use
+ *
+ * @param iterator Iterator freshly opened by dir_iterator_open(), positioned right after the entry when found
+ * @param name     8-byte entry name
+ * @param ext      3-byte entry extension
+ * @return         Pointer to entry inside iterator table, NULL if not found
+ */
+struct FAT32DirectoryEntry *dir_iterator_lookup(struct FAT32DirectoryIterator *iterator, const char *name, const char *ext);
+
 /**
  * Checking whether filesystem signature is missing or not in boot sector
  *
@@ -165,37 +513,110 @@ void init_directory_table(struct FAT32DirectoryTable *dir_table, char *name, uin
 bool is_empty_storage(void);
 
 /**
- * Create new FAT32 file system. Will write fs_signature into boot sector and
- * proper FileAllocationTable (contain CLUSTER_0_VALUE, CLUSTER_1_VALUE,
- * and initialized root directory) into cluster number 1
+ * Create new FAT32 file system sized from disk_block_count(). Will write fs_signature into boot sector,
+ * FAT32InfoSector and proper FileAllocationTable (contain CLUSTER_0_VALUE, CLUSTER_1_VALUE,
+ * and initialized root directory) starting from cluster number 1
  */
 void create_fat32(void);
 
 /**
  * Initialize file system driver state, if is_empty_storage() then create_fat32()
- * Else, read and cache entire FileAllocationTable (located at cluster number 1) into driver state
+ * Else, read volume geometry and build cluster allocator from FileAllocationTable.
+ * FAT sector is loaded into driver state on demand
  */
 void initialize_filesystem_fat32(void);
 
 /**
- * Write cluster operation, wrapper for write_blocks().
+ * Flush every dirty cluster in buffer cache and dirty FAT sector into disk.
+ * On journaled volume, metadata is made durable by committing running transaction instead
+ */
+void sync_filesystem_fat32(void);
+
+/**
+ * Background flusher, called on every timer tick while no file system operation is running.
+ * Every FAT32_FLUSH_INTERVAL tick, old or excess dirty cluster is written with bcache_writeback().
+ * Metadata dirty for BCACHE_WRITEBACK_EXPIRE pass is written together with every dirty cluster.
+ * Written cluster is never one freed by uncommitted transaction, allocator hold it back until commit
+ */
+void fat32_flush_tick(void);
+
+/**
+ * Get FAT entry count of mounted volume
+ *
+ * @return Cluster count, valid cluster number is below this
+ */
+uint32_t fat_cluster_count(void);
+
+/**
+ * Get FileAllocationTable entry, loading its sector if not cached
+ *
+ * @param cluster_number Cluster number
+ * @return               Next cluster in chain, FAT32_FAT_END_OF_FILE or FAT32_FAT_EMPTY_ENTRY
+ */
+uint32_t fat_get(uint32_t cluster_number);
+
+/**
+ * Set FileAllocationTable entry in memory and mark its sector dirty, written on eviction or next flush_fat()
+ *
+ * @param cluster_number Cluster number
+ * @param value          Next cluster in chain, FAT32_FAT_END_OF_FILE or FAT32_FAT_EMPTY_ENTRY
+ */
+void fat_set(uint32_t cluster_number, uint32_t value);
+
+/**
+ * Allocate one free cluster with next-fit search starting from allocator hint.
+ * Allocated cluster is marked FAT32_FAT_END_OF_FILE, caller link it into chain with fat_set().
+ * Freeing is done by fat_set() with FAT32_FAT_EMPTY_ENTRY
+ *
+ * @return Allocated cluster number, 0 if file system is full
+ */
+uint32_t fat_allocate_cluster(void);
+
+/**
+ * Allocate contiguous run of free cluster, linked as a chain ending with FAT32_FAT_END_OF_FILE.
+ * Next-fit search take first free run of cluster_count, else the longest free run found.
+ * Call again for the rest when allocated_count is less than requested
+ *
+ * @param cluster_count   Wanted run length
+ * @param allocated_count Pointer for storing allocated run length, 0 if file system is full
+ * @return                First cluster number of allocated run
+ */
+uint32_t fat_allocate_extent(uint32_t cluster_count, uint32_t *allocated_count);
+
+/**
+ * Get amount of free cluster, maintained without scanning FAT. Cluster held by FAT32Reservation
+ * or freed by uncommitted journal transaction is counted as free, it is still free in FAT and given back when needed
+ *
+ * @return Free cluster count
+ */
+uint32_t fat_free_cluster_count(void);
+
+/**
+ * Write dirty FileAllocationTable sectors into disk, consecutive sectors are merged by I/O scheduler.
+ * Same as write_blocks(), FAT must not be accessed until disk_unplug() if called inside plugged section.
+ * On journaled volume, sectors go into running transaction instead
+ */
+void flush_fat(void);
+
+/**
+ * Write cluster operation, go through buffer cache into write_blocks().
  * Recommended to use struct ClusterBuffer
  *
  * @param ptr            Pointer to source data
  * @param cluster_number Cluster number to write
- * @param cluster_count  Cluster count to write, due limitation of write_blocks block_count 255 => max cluster_count = 63
+ * @param cluster_count  Cluster count to write
  */
-void write_clusters(const void *ptr, uint32_t cluster_number, uint8_t cluster_count);
+void write_clusters(const void *ptr, uint32_t cluster_number, uint32_t cluster_count);
 
 /**
- * Read cluster operation, wrapper for read_blocks().
+ * Read cluster operation, served from buffer cache or read_blocks().
  * Recommended to use struct ClusterBuffer
  *
  * @param ptr            Pointer to buffer for reading
  * @param cluster_number Cluster number to read
- * @param cluster_count  Cluster count to read, due limitation of read_blocks block_count 255 => max cluster_count = 63
+ * @param cluster_count  Cluster count to read
  */
-void read_clusters(void *ptr, uint32_t cluster_number, uint8_t cluster_count);
+void read_clusters(void *ptr, uint32_t cluster_number, uint32_t cluster_count);
 
 /* -- CRUD Operation -- */
 
@@ -219,8 +640,27 @@ int8_t read_directory(struct FAT32DriverRequest request);
  */
 int8_t read(struct FAT32DriverRequest request);
 
+/**
+ * FAT32 positional read, read part of a file. Only cluster covering the range is read
+ *
+ * @param request buf is destination, buffer_size is byte count to read, other attribute locate the file
+ * @param range   offset is starting byte, transferred is set to byte count read, less than buffer_size near end of file
+ * @return Error code: 0 success - 1 not a file - 3 not found - -1 unknown
+ */
+int8_t pread(struct FAT32DriverRequest request, struct FAT32FileRange *range);
+
 int32_t ceil_div(int32_t a, int32_t b);
 
+/**
+ * Resolve whole path into directory entry, every component is looked up through dentry cache.
+ * Last component without extension is matched as directory first, then as file without extension
+ *
+ * @param request Path and starting directory
+ * @param result  Pointer for storing the result. On return code 1, parent_cluster_number, name and ext is still set
+ * @return Error code: 0 success - 1 last component not found - 2 middle component not found or not a folder - -1 invalid path
+ */
+int8_t resolve_path(struct FAT32PathRequest request, struct FAT32ResolvedPath *result);
+
 /**
  * FAT32 write, write a file or folder to file system.
  *
@@ -229,6 +669,114 @@ int32_t ceil_div(int32_t a, int32_t b);
  */
 int8_t write(struct FAT32DriverRequest request);
 
+/**
+ * FAT32 positional write, overwrite part of an existing file. File grow when range pass its end,
+ * gap between old end and offset is filled with zero
+ *
+ * @param request buf is source, buffer_size is byte count to write, other attribute locate the file
+ * @param range   offset is starting byte, transferred is set to byte count written
+ * @return Error code: 0 success - 1 not a file - 2 not enough space - 3 not found - -1 unknown
+ */
+int8_t pwrite(struct FAT32DriverRequest request, struct FAT32FileRange *range);
+
+/**
+ * FAT32 append, add data at the end of an existing file. Only the tail cluster and new cluster are written
+ *
+ * @param request buf is source, buffer_size is byte count to append, other attribute locate the file
+ * @return Error code: 0 success - 1 not a file - 2 not enough space - 3 not found - -1 unknown
+ */
+int8_t append(struct FAT32DriverRequest request);
+
+/**
+ * FAT32 overwrite, replace content of an existing file in place. Existing cluster is reused,
+ * chain is extended or its tail is freed to fit the new size
+ *
+ * @param request buf is new content, buffer_size is new file size, other attribute locate the file
+ * @return Error code: 0 success - 1 not a file - 2 not enough space - 3 not found - -1 unknown
+ */
+int8_t overwrite(struct FAT32DriverRequest request);
+
+/**
+ * Open existing file. Descriptor cache the directory entry location, first cluster and last accessed cluster,
+ * so sequential file_read() / file_write() need no directory search and no walk from first cluster
+ *
+ * @param request    Locate the file, buf and buffer_size is unused
+ * @param descriptor Descriptor to fill, offset start at 0
+ * @return Error code: 0 success - 1 not a file - 3 not found - 4 open file table full - -1 unknown
+ */
+int8_t file_open(struct FAT32DriverRequest request, struct FAT32FileDescriptor *descriptor);
+
+/**
+ * Read from descriptor offset and advance it
+ *
+ * @param descriptor  Open descriptor
+ * @param buf         Destination buffer
+ * @param count       Byte count to read
+ * @param transferred Pointer for storing byte count read, less than count near end of file
+ * @return Error code: 0 success - -1 descriptor is closed or file was deleted
+ */
+int8_t file_read(struct FAT32FileDescriptor *descriptor, void *buf, uint32_t count, uint32_t *transferred);
+
+/**
+ * Write at descriptor offset and advance it. File grow like pwrite()
+ *
+ * @param descriptor  Open descriptor
+ * @param buf         Source buffer
+ * @param count       Byte count to write
+ * @param transferred Pointer for storing byte count written
+ * @return Error code: 0 success - 2 not enough space - -1 descriptor is closed or file was deleted
+ */
+int8_t file_write(struct FAT32FileDescriptor *descriptor, const void *buf, uint32_t count, uint32_t *transferred);
+
+/**
+ * Move descriptor offset, offset past end of file is allowed and later write fill the gap with zero
+ *
+ * @param descriptor Open descriptor
+ * @param offset     Byte offset relative to whence
+ * @param whence     FAT32_SEEK_SET, FAT32_SEEK_CUR or FAT32_SEEK_END
+ * @param position   Pointer for storing new offset
+ * @return Error code: 0 success - -1 invalid descriptor, whence or resulting offset
+ */
+int8_t file_seek(struct FAT32FileDescriptor *descriptor, int32_t offset, uint8_t whence, uint32_t *position);
+
+/**
+ * Close descriptor, open file record is released with its last descriptor
+ *
+ * @param descriptor Open descriptor
+ * @return Error code: 0 success - -1 descriptor is not open
+ */
+int8_t file_close(struct FAT32FileDescriptor *descriptor);
+
+/**
+ * Make content and metadata of descriptor file durable. Write-back state is volume wide,
+ * so every dirty cluster and metadata is written along with it
+ *
+ * @param descriptor Open descriptor
+ * @return Error code: 0 success - -1 descriptor is closed or file was deleted
+ */
+int8_t file_sync(struct FAT32FileDescriptor *descriptor);
+
+/**
+ * FAT32 copy, create new file holding content of existing file. Content is copied cluster to cluster
+ * inside the kernel, new file is placed in as few contiguous run as possible
+ *
+ * @param src_request  name, ext and parent_cluster_number locate source file, buf and buffer_size is unused
+ * @param dest_request name, ext and parent_cluster_number of new file, buf and buffer_size is unused
+ * @return Error code: 0 success - 1 destination already exist - 2 source is not a file - 3 source not found - -1 unknown
+ */
+int8_t copy_file(struct FAT32DriverRequest src_request, struct FAT32DriverRequest dest_request);
+
+/**
+ * FAT32 move, move file or directory entry into another directory and / or rename it.
+ * Only the directory entry is relinked, content cluster is untouched. Moved directory get its parent pointer updated
+ *
+ * @param src_request  name, ext and parent_cluster_number locate the entry, buf and buffer_size is unused
+ * @param dest_request parent_cluster_number is target directory, name and ext is new name, buf and buffer_size is unused
+ * @return Error code: 0 success - 1 source not found - 2 destination already exist - 3 directory moved into itself -
+ *         4 directory renamed without "dir" extension or file renamed with it - -1 unknown
+ */
+int8_t move_dir(struct FAT32DriverRequest src_request, struct FAT32DriverRequest dest_request);
+
 /**
  * FAT32 delete, delete a file or empty directory (only 1 DirectoryEntry) in file system.
  *
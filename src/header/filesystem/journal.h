@@ -0,0 +1,248 @@
+#ifndef _JOURNAL_H
+#define _JOURNAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "header/driver/disk.h"
+
+/**
+ * Metadata journal - Write-ahead log of FAT sector and directory cluster, located between FAT and data cluster.
+ * Metadata block written by many operation is collected into running transaction in memory, a block written
+ * again is absorbed into its logged copy. Commit write the whole transaction as one sequential request:
+ * descriptor block, every logged block and commit block. Logged block reach its home location only on
+ * checkpoint, done lazily when log region or memory is running out. Mount replay every committed transaction
+ *
+ * On disk layout, starting from journal LBA:
+ * - Block 0: JournalSuperblock, sequence of first transaction to replay
+ * - Block 1+: Transactions, JournalDescriptorBlock, logged blocks, JournalCommitBlock
+ */
+
+/* -- Journal constants -- */
+// Logged block kept in memory until checkpoint, can be overridden at compile time
+#ifndef JOURNAL_BUFFER_COUNT
+#define JOURNAL_BUFFER_COUNT 128
+#endif
+
+// Largest transaction, must fit JOURNAL_DESCRIPTOR_CAPACITY. Running transaction reaching it is committed
+#define JOURNAL_TRANSACTION_MAX 48
+
+// Running transaction size where BCACHE_WRITE_BACK commit the group
+#define JOURNAL_GROUP_COMMIT 32
+
+#define JOURNAL_HASH_SIZE           64
+#define JOURNAL_NO_BLOCK            -1
+#define JOURNAL_DESCRIPTOR_CAPACITY ((BLOCK_SIZE - 16) / sizeof(uint32_t))
+
+#define JOURNAL_SIGNATURE   "IF2230JL"
+#define JOURNAL_MAGIC       0x4C4E524A
+#define JOURNAL_DESCRIPTOR  1
+#define JOURNAL_COMMIT      2
+
+/**
+ * JournalSuperblock - First block of journal region
+ *
+ * @param signature JOURNAL_SIGNATURE
+ * @param sequence  Sequence of transaction expected at block 1, older transaction in log is already checkpointed
+ */
+struct JournalSuperblock
+{
+    char signature[8];
+    uint32_t sequence;
+    uint8_t reserved[BLOCK_SIZE - 12];
+} __attribute__((packed));
+
+/**
+ * JournalDescriptorBlock - First block of transaction
+ *
+ * @param magic    JOURNAL_MAGIC
+ * @param type     JOURNAL_DESCRIPTOR
+ * @param sequence Transaction sequence
+ * @param count    Amount of logged block following this block
+ * @param home_lba Home location of each logged block
+ */
+struct JournalDescriptorBlock
+{
+    uint32_t magic;
+    uint32_t type;
+    uint32_t sequence;
+    uint32_t count;
+    uint32_t home_lba[JOURNAL_DESCRIPTOR_CAPACITY];
+} __attribute__((packed));
+
+/**
+ * JournalCommitBlock - Last block of transaction, transaction without valid commit block is not replayed
+ *
+ * @param magic    JOURNAL_MAGIC
+ * @param type     JOURNAL_COMMIT
+ * @param sequence Transaction sequence
+ * @param count    Amount of logged block
+ * @param checksum FNV-1a of descriptor home_lba list and every logged block
+ */
+struct JournalCommitBlock
+{
+    uint32_t magic;
+    uint32_t type;
+    uint32_t sequence;
+    uint32_t count;
+    uint32_t checksum;
+    uint8_t reserved[BLOCK_SIZE - 20];
+} __attribute__((packed));
+
+/**
+ * JournalBlockState - Where newest content of logged block is
+ *
+ * JOURNAL_BLOCK_FREE      - Buffer is unused
+ * JOURNAL_BLOCK_RUNNING   - Modified by running transaction, not yet in log
+ * JOURNAL_BLOCK_COMMITTED - In log, not yet written to home location
+ */
+enum JournalBlockState
+{
+    JOURNAL_BLOCK_FREE,
+    JOURNAL_BLOCK_RUNNING,
+    JOURNAL_BLOCK_COMMITTED,
+};
+
+/**
+ * JournalBlock - In-memory copy of one logged block
+ *
+ * @param data      Newest content of the block
+ * @param home_lba  Home location of the block
+ * @param state     JournalBlockState
+ * @param hash_next Next buffer index in the same hash bucket
+ */
+struct JournalBlock
+{
+    struct BlockBuffer data;
+    uint32_t home_lba;
+    enum JournalBlockState state;
+    int16_t hash_next;
+};
+
+/**
+ * JournalStatistics - Journal counters since journal_mount()
+ *
+ * @param transaction Committed transaction
+ * @param logged      Block written into log
+ * @param absorbed    Block write merged into block already in running transaction
+ * @param checkpoint  Checkpoint done
+ * @param home_write  Block written into home location by checkpoint
+ * @param replayed    Transaction replayed on mount
+ */
+struct JournalStatistics
+{
+    uint32_t transaction;
+    uint32_t logged;
+    uint32_t absorbed;
+    uint32_t checkpoint;
+    uint32_t home_write;
+    uint32_t replayed;
+} __attribute__((packed));
+
+/**
+ * JournalState - Contain all journal states
+ *
+ * @param block         Logged block buffers
+ * @param hash_head     First buffer index of each hash bucket, keyed by home LBA
+ * @param lba           First block of journal region, superblock
+ * @param block_count   Journal region size, 0 if journal is disabled
+ * @param head          Log position of next transaction, relative to lba
+ * @param sequence      Sequence of next transaction
+ * @param running_count Amount of block in running transaction
+ * @param used_count    Amount of non-free buffer
+ * @param descriptor    Descriptor block of the transaction being committed
+ * @param commit        Commit block of the transaction being committed
+ * @param statistics    Counters
+ */
+struct JournalState
+{
+    struct JournalBlock block[JOURNAL_BUFFER_COUNT];
+    int16_t hash_head[JOURNAL_HASH_SIZE];
+    uint32_t lba;
+    uint32_t block_count;
+    uint32_t head;
+    uint32_t sequence;
+    uint32_t running_count;
+    uint32_t used_count;
+    struct JournalDescriptorBlock descriptor;
+    struct JournalCommitBlock commit;
+    struct JournalStatistics statistics;
+};
+
+/**
+ * Create empty journal in region and enable it, called by create_fat32()
+ *
+ * @param lba         First block of journal region
+ * @param block_count Journal region size, 0 to disable journal
+ */
+void journal_format(uint32_t lba, uint32_t block_count);
+
+/**
+ * Enable journal of mounted volume, every committed transaction in log is written into its home location.
+ * Logged block in memory is dropped without writing
+ *
+ * @param lba         First block of journal region
+ * @param block_count Journal region size, 0 to disable journal
+ */
+void journal_mount(uint32_t lba, uint32_t block_count);
+
+/**
+ * Check whether metadata write should go through journal
+ *
+ * @return True if journal is enabled
+ */
+bool journal_enabled(void);
+
+/**
+ * Add blocks into running transaction instead of writing them into home location. All or none is logged
+ *
+ * @param home_lba    Home location of first block
+ * @param ptr         Newest content of the blocks
+ * @param block_count Amount of consecutive block
+ * @return            False if running transaction or buffers is full, caller must commit and retry
+ */
+bool journal_log_blocks(uint32_t home_lba, const void *ptr, uint32_t block_count);
+
+/**
+ * Read newest content of logged blocks
+ *
+ * @param ptr         Pointer to buffer for reading
+ * @param home_lba    Home location of first block
+ * @param block_count Amount of consecutive block
+ * @return            False if any of the blocks is not held by journal, ptr is unspecified
+ */
+bool journal_read_blocks(void *ptr, uint32_t home_lba, uint32_t block_count);
+
+/**
+ * Check whether journal hold newer content than home location of a block
+ *
+ * @param home_lba Home location of the block
+ * @return         True if block is logged and not yet checkpointed
+ */
+bool journal_contains(uint32_t home_lba);
+
+/**
+ * Amount of block in running transaction
+ *
+ * @return Block count
+ */
+uint32_t journal_running_count(void);
+
+/**
+ * Write running transaction into log with one sequential request. Checkpoint when log region or buffers
+ * can no longer hold a full transaction. Caller must write data the transaction point to beforehand
+ */
+void journal_commit(void);
+
+/**
+ * Commit running transaction, then write every logged block into home location and empty the log
+ */
+void journal_checkpoint(void);
+
+/**
+ * Copy journal counters
+ *
+ * @param statistics Pointer for storing the counters
+ */
+void journal_statistics(struct JournalStatistics *statistics);
+
+#endif
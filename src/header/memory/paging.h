@@ -191,4 +191,14 @@ struct PageDirectory* paging_get_current_page_directory_addr(void);
  */
 void paging_use_page_directory(struct PageDirectory *page_dir_virtual_addr);
 
+/**
+ * Translate virtual address into physical address with currently active page directory.
+ * Used by device driver that need physical address, ex: bus master DMA
+ *
+ * @param virtual_addr  Virtual address to translate
+ * @param physical_addr Pointer for storing translated physical address
+ * @return              True if virtual_addr is mapped in active page directory
+ */
+bool paging_virtual_to_physical(void *virtual_addr, uint32_t *physical_addr);
+
 #endif
\ No newline at end of file
@@ -12,6 +12,7 @@
 #define PROCESS_NAME_LENGTH_MAX          32
 #define PROCESS_PAGE_FRAME_COUNT_MAX     8
 #define PROCESS_COUNT_MAX                16
+#define PROCESS_FILE_DESCRIPTOR_MAX      8
 
 #define KERNEL_RESERVED_PAGE_FRAME_COUNT 4
 #define KERNEL_VIRTUAL_ADDRESS_BASE      0xC0000000
@@ -79,6 +80,7 @@ typedef enum PROCESS_STATE {
  * @param metadata Process metadata, contain various information about process
  * @param context  Process context used for context saving & switching
  * @param memory   Memory used for the process
+ * @param file     Open file descriptor, fd is index into descriptor
  */
 struct ProcessControlBlock {
     struct {
@@ -93,6 +95,10 @@ struct ProcessControlBlock {
     } memory;
 
     struct Context context;
+
+    struct {
+        struct FAT32FileDescriptor descriptor[PROCESS_FILE_DESCRIPTOR_MAX];
+    } file;
 };
 
 extern struct ProcessControlBlock _process_list[PROCESS_COUNT_MAX];
@@ -131,4 +137,53 @@ bool process_destroy(uint32_t pid);
 
 void ps(char* buffer);
 
+/**
+ * Open file into free descriptor of current process
+ *
+ * @param request Locate the file, buf and buffer_size is unused
+ * @param fd      Pointer for storing file descriptor, -1 on failure
+ * @return        Error code of file_open(), 5 if process has no free descriptor
+ */
+int8_t process_file_open(struct FAT32DriverRequest request, int32_t* fd);
+
+/**
+ * Read through file descriptor of current process
+ *
+ * @param request fd, destination and byte count, transferred is set
+ * @return        Error code of file_read(), -1 if fd is not open
+ */
+int8_t process_file_read(struct FAT32FileRequest* request);
+
+/**
+ * Write through file descriptor of current process
+ *
+ * @param request fd, source and byte count, transferred is set
+ * @return        Error code of file_write(), -1 if fd is not open
+ */
+int8_t process_file_write(struct FAT32FileRequest* request);
+
+/**
+ * Move offset of file descriptor of current process
+ *
+ * @param request fd, offset and whence, position is set
+ * @return        Error code of file_seek(), -1 if fd is not open
+ */
+int8_t process_file_seek(struct FAT32SeekRequest* request);
+
+/**
+ * Close file descriptor of current process
+ *
+ * @param fd File descriptor
+ * @return   Error code of file_close(), -1 if fd is not open
+ */
+int8_t process_file_close(int32_t fd);
+
+/**
+ * Make file of current process descriptor durable
+ *
+ * @param fd File descriptor
+ * @return   Error code of file_sync(), -1 if fd is not open
+ */
+int8_t process_file_sync(int32_t fd);
+
 #endif
\ No newline at end of file
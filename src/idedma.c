@@ -0,0 +1,103 @@
+#include "header/driver/idedma.h"
+#include "header/cpu/portio.h"
+#include "header/memory/paging.h"
+
+__attribute__((aligned(64))) static struct PhysicalRegionDescriptor prd_table[IDE_PRD_TABLE_SIZE];
+
+static struct IDEDMADriverState ide_dma_state = {
+    .bus_master_present = false,
+};
+
+bool initialize_ide_dma(void) {
+    struct PCIDeviceAddress controller;
+    if (!pci_find_device_by_class(PCI_CLASS_MASS_STORAGE, PCI_SUBCLASS_IDE, &controller))
+        return false;
+
+    uint32_t prog_if = (pci_config_read(controller, PCI_REGISTER_CLASS) >> 8) & 0xFF;
+    if (!(prog_if & PCI_PROG_IF_BUS_MASTER))
+        return false;
+
+    uint32_t bar4 = pci_config_read(controller, PCI_REGISTER_BAR4) & PCI_BAR_IO_ADDRESS_MASK;
+    if (bar4 == 0)
+        return false;
+
+    uint32_t command = pci_config_read(controller, PCI_REGISTER_COMMAND);
+    pci_config_write(controller, PCI_REGISTER_COMMAND, command | PCI_COMMAND_IO_SPACE | PCI_COMMAND_BUS_MASTER);
+
+    uint32_t prd_table_physical;
+    if (!paging_virtual_to_physical(prd_table, &prd_table_physical))
+        return false;
+    out32(bar4 + IDE_BM_REGISTER_PRDT, prd_table_physical);
+
+    ide_dma_state.controller         = controller;
+    ide_dma_state.bus_master_base    = bar4;
+    ide_dma_state.bus_master_present = true;
+    return true;
+}
+
+bool ide_dma_prepare(const struct ATASegment *segment, uint8_t segment_count, bool to_memory) {
+    if (!ide_dma_state.bus_master_present)
+        return false;
+
+    // Split every segment at 64 KiB boundary, 4 MiB page boundary is also 64 KiB boundary
+    uint32_t prd_count = 0;
+    for (uint8_t i = 0; i < segment_count; i++) {
+        uint8_t  *region   = (uint8_t*)segment[i].buf;
+        uint32_t remaining = segment[i].block_count * BLOCK_SIZE;
+        if ((uint32_t)region & 1)
+            return false;
+
+        while (remaining > 0) {
+            if (prd_count >= IDE_PRD_TABLE_SIZE)
+                return false;
+
+            uint32_t physical_address;
+            if (!paging_virtual_to_physical(region, &physical_address))
+                return false;
+
+            uint32_t until_boundary = IDE_PRD_BOUNDARY - (physical_address & (IDE_PRD_BOUNDARY - 1));
+            uint32_t length         = remaining < until_boundary ? remaining : until_boundary;
+            prd_table[prd_count].physical_address = physical_address;
+            prd_table[prd_count].byte_count       = (uint16_t)length;
+            prd_table[prd_count].flag             = 0;
+            prd_count++;
+
+            region    += length;
+            remaining -= length;
+        }
+    }
+    if (prd_count == 0)
+        return false;
+    prd_table[prd_count - 1].flag = IDE_PRD_END_OF_TABLE;
+
+    uint16_t base = ide_dma_state.bus_master_base;
+    out(base + IDE_BM_REGISTER_COMMAND, to_memory ? IDE_BM_COMMAND_READ : 0);
+    // Status interrupt and error bit is cleared by writing 1
+    out(base + IDE_BM_REGISTER_STATUS, IDE_BM_STATUS_INTERRUPT | IDE_BM_STATUS_ERROR);
+    return true;
+}
+
+void ide_dma_start(void) {
+    uint16_t base    = ide_dma_state.bus_master_base;
+    uint8_t  command = in(base + IDE_BM_REGISTER_COMMAND);
+    out(base + IDE_BM_REGISTER_COMMAND, command | IDE_BM_COMMAND_START);
+}
+
+bool ide_dma_is_done(void) {
+    uint8_t status = in(ide_dma_state.bus_master_base + IDE_BM_REGISTER_STATUS);
+    return (status & (IDE_BM_STATUS_INTERRUPT | IDE_BM_STATUS_ERROR)) || !(status & IDE_BM_STATUS_ACTIVE);
+}
+
+bool ide_dma_finish(void) {
+    uint16_t base    = ide_dma_state.bus_master_base;
+    uint8_t  command = in(base + IDE_BM_REGISTER_COMMAND);
+    uint8_t  status  = in(base + IDE_BM_REGISTER_STATUS);
+    out(base + IDE_BM_REGISTER_COMMAND, command & ~IDE_BM_COMMAND_START);
+
+    // Reading ATA status acknowledge drive interrupt
+    while (in(ATA_PRIMARY_STATUS) & ATA_STATUS_BSY);
+    uint8_t ata_status = in(ATA_PRIMARY_STATUS);
+    out(base + IDE_BM_REGISTER_STATUS, IDE_BM_STATUS_INTERRUPT | IDE_BM_STATUS_ERROR);
+
+    return !(status & IDE_BM_STATUS_ERROR) && !(ata_status & (ATA_STATUS_ERR | ATA_STATUS_DF));
+}
@@ -1,8 +1,11 @@
 #include "header/cpu/portio.h"
 #include "header/cpu/interrupt.h"
 #include "header/driver/keyboard.h"
+#include "header/driver/disk.h"
+#include "header/driver/iostat.h"
 #include "header/cpu/gdt.h"
 #include "header/filesystem/fat32.h"
+#include "header/filesystem/bcache.h"
 #include "header/driver/framebuffer.h"
 #include "header/stdlib/string.h"
 #include "header/process/process.h"
@@ -146,9 +149,71 @@ void syscall(struct InterruptFrame frame)
   case (18):
     print_path_to_dir((char *)frame.cpu.general.ebx, frame.cpu.general.ecx, (char *)frame.cpu.general.edx);
     break;
-  // case (18):
-  //   *((int8_t *)frame.cpu.general.ecx) = move_dir(*(struct FAT32DriverRequest *)frame.cpu.general.ebx, *(struct FAT32DriverRequest *)frame.cpu.general.edx);
-  //   break;
+  case (20):
+    disk_scheduler_statistics((struct ATASchedulerStatistics *)frame.cpu.general.ebx);
+    break;
+  case (21):
+    bcache_statistics((struct BufferCacheStatistics *)frame.cpu.general.ebx);
+    break;
+  case (22):
+    iostat_snapshot((struct IOStatistics *)frame.cpu.general.ebx);
+    break;
+  case (23):
+    *((int8_t *)frame.cpu.general.ecx) = resolve_path(
+        *(struct FAT32PathRequest *)frame.cpu.general.ebx,
+        (struct FAT32ResolvedPath *)frame.cpu.general.edx);
+    break;
+  case (24):
+    *((int8_t *)frame.cpu.general.ecx) = pread(
+        *(struct FAT32DriverRequest *)frame.cpu.general.ebx,
+        (struct FAT32FileRange *)frame.cpu.general.edx);
+    break;
+  case (25):
+    *((int8_t *)frame.cpu.general.ecx) = pwrite(
+        *(struct FAT32DriverRequest *)frame.cpu.general.ebx,
+        (struct FAT32FileRange *)frame.cpu.general.edx);
+    break;
+  case (26):
+    *((int8_t *)frame.cpu.general.ecx) = append(
+        *(struct FAT32DriverRequest *)frame.cpu.general.ebx);
+    break;
+  case (27):
+    *((int8_t *)frame.cpu.general.ecx) = overwrite(
+        *(struct FAT32DriverRequest *)frame.cpu.general.ebx);
+    break;
+  case (28):
+    *((int8_t *)frame.cpu.general.ecx) = process_file_open(
+        *(struct FAT32DriverRequest *)frame.cpu.general.ebx,
+        (int32_t *)frame.cpu.general.edx);
+    break;
+  case (29):
+    *((int8_t *)frame.cpu.general.ecx) = process_file_read((struct FAT32FileRequest *)frame.cpu.general.ebx);
+    break;
+  case (30):
+    *((int8_t *)frame.cpu.general.ecx) = process_file_write((struct FAT32FileRequest *)frame.cpu.general.ebx);
+    break;
+  case (31):
+    *((int8_t *)frame.cpu.general.ecx) = process_file_seek((struct FAT32SeekRequest *)frame.cpu.general.ebx);
+    break;
+  case (32):
+    *((int8_t *)frame.cpu.general.ecx) = process_file_close((int32_t)frame.cpu.general.ebx);
+    break;
+  case (33):
+    sync_filesystem_fat32();
+    break;
+  case (34):
+    *((int8_t *)frame.cpu.general.ecx) = process_file_sync((int32_t)frame.cpu.general.ebx);
+    break;
+  case (35):
+    *((int8_t *)frame.cpu.general.ecx) = copy_file(
+        *(struct FAT32DriverRequest *)frame.cpu.general.ebx,
+        *(struct FAT32DriverRequest *)frame.cpu.general.edx);
+    break;
+  case (36):
+    *((int8_t *)frame.cpu.general.ecx) = move_dir(
+        *(struct FAT32DriverRequest *)frame.cpu.general.ebx,
+        *(struct FAT32DriverRequest *)frame.cpu.general.edx);
+    break;
   }
 }
 
@@ -171,9 +236,18 @@ void main_interrupt_handler(struct InterruptFrame frame)
     break;
   case PIC1_OFFSET + IRQ_TIMER:
     pic_ack(0); // timer_isr();
-    scheduler_save_context_to_current_running_pcb(create_context_from_interrupt_frame(frame));
+    // Timer can also fire while kernel halt waiting for disk, only user context is saved
+    if ((frame.int_stack.cs & 0x3) == 0x3)
+    {
+      scheduler_save_context_to_current_running_pcb(create_context_from_interrupt_frame(frame));
+      // Interrupted user code mean no file system operation is halfway
+      fat32_flush_tick();
+    }
     //scheduler_switch_to_next_process(); // black screen error
     break;
+  case PIC1_OFFSET + IRQ_PRIMARY_ATA:
+    disk_isr();
+    break;
   case 0x30:
     syscall(frame);
     break;
@@ -185,6 +259,12 @@ void activate_keyboard_interrupt(void)
   out(PIC1_DATA, in(PIC1_DATA) & ~(1 << IRQ_KEYBOARD));
 }
 
+void activate_disk_interrupt(void)
+{
+  out(PIC1_DATA, in(PIC1_DATA) & ~(1 << IRQ_CASCADE));
+  out(PIC2_DATA, in(PIC2_DATA) & ~(1 << (IRQ_PRIMARY_ATA - 8)));
+}
+
 struct TSSEntry _interrupt_tss_entry = {
     .ss0 = GDT_KERNEL_DATA_SEGMENT_SELECTOR,
 };
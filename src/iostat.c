@@ -0,0 +1,54 @@
+#include "header/driver/iostat.h"
+
+static struct IOStatistics iostat_state = {0};
+
+static enum IOStatClass iostat_class = IOSTAT_CLASS_OTHER;
+
+// Index of highest set bit, only shift is used so 64-bit division helper is not needed
+static uint8_t iostat_bucket(uint64_t cycles) {
+    uint8_t bucket = 0;
+    while (cycles > 1 && bucket < IOSTAT_HISTOGRAM_BUCKET - 1) {
+        cycles >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+uint64_t iostat_timestamp(void) {
+    uint32_t low, high;
+    __asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+enum IOStatClass iostat_set_class(enum IOStatClass io_class) {
+    enum IOStatClass previous = iostat_class;
+    iostat_class = io_class;
+    return previous;
+}
+
+enum IOStatClass iostat_get_class(void) {
+    return iostat_class;
+}
+
+void iostat_record(bool write, uint32_t block_count, uint64_t cycles) {
+    struct IOStatClassStatistics *statistics = &iostat_state.class_statistics[iostat_class];
+    if (write) {
+        statistics->write_request++;
+        statistics->block_written += block_count;
+        if (cycles > 0)
+            statistics->write_latency[iostat_bucket(cycles)]++;
+    } else {
+        statistics->read_request++;
+        statistics->block_read += block_count;
+        if (cycles > 0)
+            statistics->read_latency[iostat_bucket(cycles)]++;
+    }
+}
+
+void iostat_record_cache_hit(uint32_t cluster_count) {
+    iostat_state.class_statistics[iostat_class].cache_hit += cluster_count;
+}
+
+void iostat_snapshot(struct IOStatistics *statistics) {
+    *statistics = iostat_state;
+}
@@ -0,0 +1,358 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "header/stdlib/string.h"
+#include "header/filesystem/journal.h"
+#include "header/driver/iostat.h"
+
+static struct JournalState journal_state = {0};
+
+// Superblock is written from here, buffer stay valid until dispatched
+static struct JournalSuperblock journal_superblock = {0};
+
+static uint32_t journal_hash(uint32_t home_lba)
+{
+    return home_lba % JOURNAL_HASH_SIZE;
+}
+
+// FNV-1a, continuing from hash
+static uint32_t journal_checksum(uint32_t hash, const void *ptr, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; i++)
+        hash = (hash ^ ((const uint8_t *)ptr)[i]) * 16777619u;
+    return hash;
+}
+
+static int16_t journal_lookup(uint32_t home_lba)
+{
+    int16_t index = journal_state.hash_head[journal_hash(home_lba)];
+    while (index != JOURNAL_NO_BLOCK && journal_state.block[index].home_lba != home_lba)
+        index = journal_state.block[index].hash_next;
+    return index;
+}
+
+static int16_t journal_insert(uint32_t home_lba)
+{
+    int16_t index = 0;
+    while (journal_state.block[index].state != JOURNAL_BLOCK_FREE)
+        index++;
+
+    struct JournalBlock *block     = &journal_state.block[index];
+    uint32_t bucket                = journal_hash(home_lba);
+    block->home_lba                = home_lba;
+    block->hash_next               = journal_state.hash_head[bucket];
+    journal_state.hash_head[bucket] = index;
+    journal_state.used_count++;
+    return index;
+}
+
+static void journal_remove(int16_t index)
+{
+    struct JournalBlock *block = &journal_state.block[index];
+    int16_t *link              = &journal_state.hash_head[journal_hash(block->home_lba)];
+    while (*link != index)
+        link = &journal_state.block[*link].hash_next;
+    *link        = block->hash_next;
+    block->state = JOURNAL_BLOCK_FREE;
+    journal_state.used_count--;
+}
+
+static void journal_reset(uint32_t lba, uint32_t block_count)
+{
+    for (uint16_t i = 0; i < JOURNAL_HASH_SIZE; i++)
+        journal_state.hash_head[i] = JOURNAL_NO_BLOCK;
+    for (int16_t i = 0; i < JOURNAL_BUFFER_COUNT; i++)
+        journal_state.block[i].state = JOURNAL_BLOCK_FREE;
+
+    journal_state.lba           = lba;
+    journal_state.block_count   = block_count;
+    journal_state.head          = 1;
+    journal_state.running_count = 0;
+    journal_state.used_count    = 0;
+    memset(&journal_state.statistics, 0, sizeof(struct JournalStatistics));
+}
+
+// Log before head is no longer needed, superblock point replay at the next transaction sequence
+static void journal_write_superblock(void)
+{
+    memset(&journal_superblock, 0, sizeof(struct JournalSuperblock));
+    memcpy(journal_superblock.signature, JOURNAL_SIGNATURE, 8);
+    journal_superblock.sequence = journal_state.sequence;
+
+    enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_JOURNAL);
+    write_blocks(&journal_superblock, journal_state.lba, 1);
+    disk_dispatch();
+    iostat_set_class(previous);
+}
+
+/**
+ * Write every committed block into home location, then empty the log. Only called with empty running
+ * transaction, block re-logged after commit would otherwise lose its committed content on crash
+ */
+static void journal_write_home(void)
+{
+    enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_JOURNAL);
+    disk_plug();
+    for (int16_t i = 0; i < JOURNAL_BUFFER_COUNT; i++)
+    {
+        struct JournalBlock *block = &journal_state.block[i];
+        if (block->state == JOURNAL_BLOCK_COMMITTED)
+        {
+            write_blocks(&block->data, block->home_lba, 1);
+            journal_state.statistics.home_write++;
+        }
+    }
+    disk_unplug();
+
+    // Home location must be written before superblock forget the log
+    disk_dispatch();
+    iostat_set_class(previous);
+
+    for (int16_t i = 0; i < JOURNAL_BUFFER_COUNT; i++)
+    {
+        if (journal_state.block[i].state == JOURNAL_BLOCK_COMMITTED)
+            journal_remove(i);
+    }
+    journal_state.head = 1;
+    journal_write_superblock();
+    journal_state.statistics.checkpoint++;
+}
+
+/**
+ * Replay committed transaction starting at block 1 in sequence order, stop at first transaction that is
+ * missing, torn or older than superblock sequence. Buffers are used as staging area
+ *
+ * @return Amount of transaction replayed
+ */
+static uint32_t journal_replay(void)
+{
+    struct JournalDescriptorBlock *descriptor = &journal_state.descriptor;
+    struct JournalCommitBlock *commit         = &journal_state.commit;
+    uint32_t replayed = 0;
+    uint32_t position = 1;
+    while (position + 2 <= journal_state.block_count)
+    {
+        read_blocks(descriptor, journal_state.lba + position, 1);
+        uint32_t count = descriptor->count;
+        if (descriptor->magic != JOURNAL_MAGIC || descriptor->type != JOURNAL_DESCRIPTOR ||
+            descriptor->sequence != journal_state.sequence || count == 0 || count > JOURNAL_TRANSACTION_MAX ||
+            position + count + 2 > journal_state.block_count)
+            break;
+
+        read_blocks(commit, journal_state.lba + position + count + 1, 1);
+        if (commit->magic != JOURNAL_MAGIC || commit->type != JOURNAL_COMMIT ||
+            commit->sequence != descriptor->sequence || commit->count != count)
+            break;
+
+        uint32_t checksum = journal_checksum(2166136261u, descriptor->home_lba, count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            read_blocks(&journal_state.block[i].data, journal_state.lba + position + 1 + i, 1);
+            checksum = journal_checksum(checksum, &journal_state.block[i].data, BLOCK_SIZE);
+        }
+        if (checksum != commit->checksum)
+            break;
+
+        disk_plug();
+        for (uint32_t i = 0; i < count; i++)
+            write_blocks(&journal_state.block[i].data, descriptor->home_lba[i], 1);
+        disk_unplug();
+        disk_dispatch();
+
+        journal_state.sequence++;
+        position += count + 2;
+        replayed++;
+    }
+    return replayed;
+}
+
+/* -- Journal interfaces -- */
+
+void journal_format(uint32_t lba, uint32_t block_count)
+{
+    journal_reset(lba, block_count);
+    journal_state.sequence = 1;
+    if (block_count == 0)
+        return;
+
+    // Transaction left in region by older volume must never look committed
+    enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_JOURNAL);
+    struct JournalBlock *zero = &journal_state.block[0];
+    memset(&zero->data, 0, BLOCK_SIZE);
+    disk_plug();
+    for (uint32_t i = 1; i < block_count; i++)
+        write_blocks(&zero->data, lba + i, 1);
+    disk_unplug();
+    disk_dispatch();
+    iostat_set_class(previous);
+
+    journal_write_superblock();
+}
+
+void journal_mount(uint32_t lba, uint32_t block_count)
+{
+    journal_reset(lba, block_count);
+    journal_state.sequence = 1;
+    if (block_count == 0)
+        return;
+
+    enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_JOURNAL);
+    read_blocks(&journal_superblock, lba, 1);
+    iostat_set_class(previous);
+    if (memcmp(journal_superblock.signature, JOURNAL_SIGNATURE, 8))
+    {
+        journal_format(lba, block_count);
+        return;
+    }
+
+    journal_state.sequence = journal_superblock.sequence;
+    previous = iostat_set_class(IOSTAT_CLASS_JOURNAL);
+    uint32_t replayed = journal_replay();
+    iostat_set_class(previous);
+    if (replayed > 0)
+        journal_write_superblock();
+    journal_state.statistics.replayed = replayed;
+}
+
+bool journal_enabled(void)
+{
+    return journal_state.block_count > 0;
+}
+
+bool journal_log_blocks(uint32_t home_lba, const void *ptr, uint32_t block_count)
+{
+    // Check room first, so blocks of one write is never split across transaction
+    uint32_t new_running = 0, new_buffer = 0;
+    for (uint32_t i = 0; i < block_count; i++)
+    {
+        int16_t index = journal_lookup(home_lba + i);
+        if (index == JOURNAL_NO_BLOCK)
+            new_buffer++;
+        if (index == JOURNAL_NO_BLOCK || journal_state.block[index].state != JOURNAL_BLOCK_RUNNING)
+            new_running++;
+    }
+    if (journal_state.running_count + new_running > JOURNAL_TRANSACTION_MAX ||
+        journal_state.used_count + new_buffer > JOURNAL_BUFFER_COUNT)
+        return false;
+
+    for (uint32_t i = 0; i < block_count; i++)
+    {
+        int16_t index = journal_lookup(home_lba + i);
+        if (index == JOURNAL_NO_BLOCK)
+            index = journal_insert(home_lba + i);
+
+        struct JournalBlock *block = &journal_state.block[index];
+        if (block->state == JOURNAL_BLOCK_RUNNING)
+            journal_state.statistics.absorbed++;
+        else
+            journal_state.running_count++;
+        block->state = JOURNAL_BLOCK_RUNNING;
+        memcpy(&block->data, (const uint8_t *)ptr + i * BLOCK_SIZE, BLOCK_SIZE);
+    }
+    return true;
+}
+
+bool journal_read_blocks(void *ptr, uint32_t home_lba, uint32_t block_count)
+{
+    for (uint32_t i = 0; i < block_count; i++)
+    {
+        int16_t index = journal_lookup(home_lba + i);
+        if (index == JOURNAL_NO_BLOCK)
+            return false;
+        memcpy((uint8_t *)ptr + i * BLOCK_SIZE, &journal_state.block[index].data, BLOCK_SIZE);
+    }
+    return true;
+}
+
+bool journal_contains(uint32_t home_lba)
+{
+    return journal_state.block_count > 0 && journal_lookup(home_lba) != JOURNAL_NO_BLOCK;
+}
+
+uint32_t journal_running_count(void)
+{
+    return journal_state.running_count;
+}
+
+void journal_commit(void)
+{
+    if (journal_state.block_count == 0)
+        return;
+
+    if (journal_state.running_count > 0)
+    {
+        // Log region always has room for a full transaction, it is checked after every commit
+        struct JournalDescriptorBlock *descriptor = &journal_state.descriptor;
+        struct JournalCommitBlock *commit         = &journal_state.commit;
+        uint32_t lba   = journal_state.lba + journal_state.head;
+        uint32_t count = 0;
+
+        enum IOStatClass previous = iostat_set_class(IOSTAT_CLASS_JOURNAL);
+        disk_plug();
+        for (int16_t i = 0; i < JOURNAL_BUFFER_COUNT; i++)
+        {
+            struct JournalBlock *block = &journal_state.block[i];
+            if (block->state == JOURNAL_BLOCK_RUNNING)
+            {
+                descriptor->home_lba[count] = block->home_lba;
+                write_blocks(&block->data, lba + 1 + count, 1);
+                count++;
+            }
+        }
+
+        uint32_t checksum = journal_checksum(2166136261u, descriptor->home_lba, count * sizeof(uint32_t));
+        for (int16_t i = 0; i < JOURNAL_BUFFER_COUNT; i++)
+        {
+            struct JournalBlock *block = &journal_state.block[i];
+            if (block->state == JOURNAL_BLOCK_RUNNING)
+            {
+                checksum     = journal_checksum(checksum, &block->data, BLOCK_SIZE);
+                block->state = JOURNAL_BLOCK_COMMITTED;
+            }
+        }
+
+        descriptor->magic    = JOURNAL_MAGIC;
+        descriptor->type     = JOURNAL_DESCRIPTOR;
+        descriptor->sequence = journal_state.sequence;
+        descriptor->count    = count;
+        memset(commit, 0, sizeof(struct JournalCommitBlock));
+        commit->magic    = JOURNAL_MAGIC;
+        commit->type     = JOURNAL_COMMIT;
+        commit->sequence = journal_state.sequence;
+        commit->count    = count;
+        commit->checksum = checksum;
+        write_blocks(descriptor, lba, 1);
+        write_blocks(commit, lba + 1 + count, 1);
+
+        // Whole transaction is one sequential run, logged buffer is reused right after this
+        disk_unplug();
+        disk_dispatch();
+        iostat_set_class(previous);
+
+        journal_state.head += count + 2;
+        journal_state.sequence++;
+        journal_state.running_count = 0;
+        journal_state.statistics.transaction++;
+        journal_state.statistics.logged += count;
+    }
+
+    // Lazy checkpoint, only when next full transaction would not fit
+    if (journal_state.head + JOURNAL_TRANSACTION_MAX + 2 > journal_state.block_count ||
+        journal_state.used_count + JOURNAL_TRANSACTION_MAX > JOURNAL_BUFFER_COUNT)
+        journal_write_home();
+}
+
+void journal_checkpoint(void)
+{
+    if (journal_state.block_count == 0)
+        return;
+
+    journal_commit();
+    if (journal_state.used_count > 0)
+        journal_write_home();
+}
+
+void journal_statistics(struct JournalStatistics *statistics)
+{
+    *statistics = journal_state.statistics;
+}
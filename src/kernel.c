@@ -9,6 +9,8 @@
 #include "header/cpu/idt.h"
 #include "header/driver/disk.h"
 #include "header/filesystem/fat32.h"
+#include "header/filesystem/bcache.h"
+#include "header/filesystem/journal.h"
 #include "header/memory/paging.h"
 #include "header/process/process.h"
 #include "header/scheduler/scheduler.h"
@@ -24,7 +26,11 @@ void kernel_setup(void)
   framebuffer_clear();
   framebuffer_set_cursor(0, 0);
   keyboard_state_activate();
+  initialize_disk();
   initialize_filesystem_fat32();
+  // Dirty cluster is written by timer flusher or sync. Only journaled volume hold freed cluster back until
+  // the freeing metadata is committed, without journal reused cluster could be written before its old owner is gone
+  bcache_configure(BCACHE_CAPACITY, journal_enabled() ? BCACHE_WRITE_BACK : BCACHE_WRITE_THROUGH);
 
   gdt_install_tss();
   set_tss_register();
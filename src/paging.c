@@ -183,4 +183,15 @@ void paging_use_page_directory(struct PageDirectory* page_dir_virtual_addr) {
     if ((uint32_t)page_dir_virtual_addr > KERNEL_VIRTUAL_ADDRESS_BASE)
         physical_addr_page_dir -= KERNEL_VIRTUAL_ADDRESS_BASE;
     __asm__  volatile("mov %0, %%cr3" : /* <Empty> */ : "r"(physical_addr_page_dir) : "memory");
-}
\ No newline at end of file
+}
+
+bool paging_virtual_to_physical(void* virtual_addr, uint32_t* physical_addr) {
+    struct PageDirectory* page_dir = paging_get_current_page_directory_addr();
+    uint32_t page_index = ((uint32_t)virtual_addr >> 22) & 0x3FF;
+    struct PageDirectoryEntry entry = page_dir->table[page_index];
+    if (!entry.flag.present_bit || !entry.flag.use_pagesize_4_mb)
+        return false;
+
+    *physical_addr = ((uint32_t)entry.lower_address << 22) | ((uint32_t)virtual_addr & (PAGE_FRAME_SIZE - 1));
+    return true;
+}
@@ -0,0 +1,44 @@
+#include "header/driver/pci.h"
+#include "header/cpu/portio.h"
+
+static uint32_t pci_config_address(struct PCIDeviceAddress device, uint8_t offset) {
+    return PCI_CONFIG_ENABLE
+        | ((uint32_t)device.bus << 16)
+        | ((uint32_t)(device.slot & 0x1F) << 11)
+        | ((uint32_t)(device.function & 0x7) << 8)
+        | (offset & 0xFC);
+}
+
+uint32_t pci_config_read(struct PCIDeviceAddress device, uint8_t offset) {
+    out32(PCI_CONFIG_ADDRESS, pci_config_address(device, offset));
+    return in32(PCI_CONFIG_DATA);
+}
+
+void pci_config_write(struct PCIDeviceAddress device, uint8_t offset, uint32_t value) {
+    out32(PCI_CONFIG_ADDRESS, pci_config_address(device, offset));
+    out32(PCI_CONFIG_DATA, value);
+}
+
+bool pci_find_device_by_class(uint8_t class_code, uint8_t subclass, struct PCIDeviceAddress *result) {
+    for (uint32_t bus = 0; bus < PCI_BUS_COUNT; bus++) {
+        for (uint8_t slot = 0; slot < PCI_SLOT_COUNT; slot++) {
+            for (uint8_t function = 0; function < PCI_FUNCTION_COUNT; function++) {
+                struct PCIDeviceAddress device = {
+                    .bus      = bus,
+                    .slot     = slot,
+                    .function = function,
+                };
+                if ((pci_config_read(device, PCI_REGISTER_VENDOR_ID) & 0xFFFF) == PCI_VENDOR_NONE)
+                    continue;
+
+                // Class register layout: class (31:24), subclass (23:16), prog if (15:8), revision (7:0)
+                uint32_t class_register = pci_config_read(device, PCI_REGISTER_CLASS);
+                if ((class_register >> 24) == class_code && ((class_register >> 16) & 0xFF) == subclass) {
+                    *result = device;
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
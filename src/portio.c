@@ -43,3 +43,21 @@ uint16_t in16(uint16_t port) {
         );
     return result;
 }
+
+void out32(uint16_t port, uint32_t data) {
+    __asm__(
+        "outl %0, %1"
+        : // <Empty output operand>
+    : "a"(data), "Nd"(port)
+        );
+}
+
+uint32_t in32(uint16_t port) {
+    uint32_t result;
+    __asm__ volatile(
+        "inl %1, %0"
+        : "=a"(result)
+        : "Nd"(port)
+        );
+    return result;
+}
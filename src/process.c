@@ -129,6 +129,7 @@ int32_t process_create_user_process(struct FAT32DriverRequest request) {
     new_pcb->metadata.pid = process_generate_new_pid();
     new_pcb->memory.page_frame_used_count = page_frame_count_needed;
     new_pcb->metadata.state = PROCESS_STATE_READY;
+    memset(&new_pcb->file, 0, sizeof(new_pcb->file));
     memcpy(new_pcb->metadata.name, request.name, strlen(request.name));
 
     process_manager_state.active_process_count++;
@@ -154,6 +155,13 @@ bool process_destroy(uint32_t pid) {
     // Release page directory
     paging_free_page_directory(pcb->context.page_directory_virtual_addr);
 
+    // Release open file
+    for (int i = 0; i < PROCESS_FILE_DESCRIPTOR_MAX; i++) {
+        if (pcb->file.descriptor[i].used) {
+            file_close(&pcb->file.descriptor[i]);
+        }
+    }
+
     // Release PCB
     pcb->metadata.pid = 0;
     pcb->metadata.name[0] = '\0';
@@ -162,6 +170,70 @@ bool process_destroy(uint32_t pid) {
     return true;
 }
 
+// Open descriptor of current process, NULL if fd is invalid or closed
+static struct FAT32FileDescriptor* process_get_file_descriptor(int32_t fd) {
+    struct ProcessControlBlock* pcb = process_get_current_running_pcb_pointer();
+    if (pcb == NULL || fd < 0 || fd >= PROCESS_FILE_DESCRIPTOR_MAX || !pcb->file.descriptor[fd].used) {
+        return NULL;
+    }
+    return &pcb->file.descriptor[fd];
+}
+
+int8_t process_file_open(struct FAT32DriverRequest request, int32_t* fd) {
+    *fd = -1;
+    struct ProcessControlBlock* pcb = process_get_current_running_pcb_pointer();
+    if (pcb == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i < PROCESS_FILE_DESCRIPTOR_MAX; i++) {
+        if (!pcb->file.descriptor[i].used) {
+            int8_t retcode = file_open(request, &pcb->file.descriptor[i]);
+            if (retcode == 0) {
+                *fd = i;
+            }
+            return retcode;
+        }
+    }
+    return 5;
+}
+
+int8_t process_file_read(struct FAT32FileRequest* request) {
+    struct FAT32FileDescriptor* descriptor = process_get_file_descriptor(request->fd);
+    uint32_t transferred = 0;
+    int8_t retcode = descriptor != NULL ? file_read(descriptor, request->buf, request->count, &transferred) : -1;
+    request->transferred = transferred;
+    return retcode;
+}
+
+int8_t process_file_write(struct FAT32FileRequest* request) {
+    struct FAT32FileDescriptor* descriptor = process_get_file_descriptor(request->fd);
+    uint32_t transferred = 0;
+    int8_t retcode = descriptor != NULL ? file_write(descriptor, request->buf, request->count, &transferred) : -1;
+    request->transferred = transferred;
+    return retcode;
+}
+
+int8_t process_file_seek(struct FAT32SeekRequest* request) {
+    struct FAT32FileDescriptor* descriptor = process_get_file_descriptor(request->fd);
+    uint32_t position = 0;
+    int8_t retcode = descriptor != NULL ? file_seek(descriptor, request->offset, request->whence, &position) : -1;
+    if (retcode == 0) {
+        request->position = position;
+    }
+    return retcode;
+}
+
+int8_t process_file_close(int32_t fd) {
+    struct FAT32FileDescriptor* descriptor = process_get_file_descriptor(fd);
+    return descriptor != NULL ? file_close(descriptor) : -1;
+}
+
+int8_t process_file_sync(int32_t fd) {
+    struct FAT32FileDescriptor* descriptor = process_get_file_descriptor(fd);
+    return descriptor != NULL ? file_sync(descriptor) : -1;
+}
+
 void int_to_str(int num, char* str) {
     int i = 0;
     int is_negative = 0;
@@ -1,5 +1,7 @@
 #include <stdint.h>
 #include "header/filesystem/fat32.h"
+#include "header/filesystem/bcache.h"
+#include "header/driver/iostat.h"
 #include "header/stdlib/string.h"
 
 struct ClusterBuffer cl[2] = {0};
@@ -48,13 +50,6 @@ void read_dir_syscall(struct FAT32DriverRequest request, int32_t *retcode)
   syscall(1, (uint32_t)&request, (uint32_t)retcode, 0);
 }
 
-int32_t move_sys(struct FAT32DriverRequest *request, struct FAT32DriverRequest *dst_request)
-{
-  uint32_t ret;
-  syscall(18, (uint32_t)request, (uint32_t)&ret, (uint32_t)dst_request);
-  return ret;
-}
-
 void write_syscall(struct FAT32DriverRequest request, int32_t *retcode)
 {
   syscall(2, (uint32_t)&request, (uint32_t)retcode, 0);
@@ -95,6 +90,106 @@ void move_parent_dir(struct FAT32DriverRequest request, int32_t *retcode)
   syscall(9, (uint32_t)&request, (uint32_t)retcode, 0);
 }
 
+int8_t resolve_path_syscall(char *path, uint32_t cluster_number, struct FAT32ResolvedPath *result)
+{
+  int8_t ret;
+  struct FAT32PathRequest path_request = {
+      .path = path,
+      .cwd_cluster_number = cluster_number,
+  };
+  syscall(23, (uint32_t)&path_request, (uint32_t)&ret, (uint32_t)result);
+  return ret;
+}
+
+int8_t pread_syscall(struct FAT32DriverRequest request, struct FAT32FileRange *range)
+{
+  int8_t ret;
+  syscall(24, (uint32_t)&request, (uint32_t)&ret, (uint32_t)range);
+  return ret;
+}
+
+int8_t pwrite_syscall(struct FAT32DriverRequest request, struct FAT32FileRange *range)
+{
+  int8_t ret;
+  syscall(25, (uint32_t)&request, (uint32_t)&ret, (uint32_t)range);
+  return ret;
+}
+
+int8_t append_syscall(struct FAT32DriverRequest request)
+{
+  int8_t ret;
+  syscall(26, (uint32_t)&request, (uint32_t)&ret, 0);
+  return ret;
+}
+
+int8_t overwrite_syscall(struct FAT32DriverRequest request)
+{
+  int8_t ret;
+  syscall(27, (uint32_t)&request, (uint32_t)&ret, 0);
+  return ret;
+}
+
+int8_t open_syscall(struct FAT32DriverRequest request, int32_t *fd)
+{
+  int8_t ret;
+  syscall(28, (uint32_t)&request, (uint32_t)&ret, (uint32_t)fd);
+  return ret;
+}
+
+int8_t read_fd_syscall(struct FAT32FileRequest *request)
+{
+  int8_t ret;
+  syscall(29, (uint32_t)request, (uint32_t)&ret, 0);
+  return ret;
+}
+
+int8_t write_fd_syscall(struct FAT32FileRequest *request)
+{
+  int8_t ret;
+  syscall(30, (uint32_t)request, (uint32_t)&ret, 0);
+  return ret;
+}
+
+int8_t seek_syscall(struct FAT32SeekRequest *request)
+{
+  int8_t ret;
+  syscall(31, (uint32_t)request, (uint32_t)&ret, 0);
+  return ret;
+}
+
+int8_t close_syscall(int32_t fd)
+{
+  int8_t ret;
+  syscall(32, (uint32_t)fd, (uint32_t)&ret, 0);
+  return ret;
+}
+
+void sync_syscall(void)
+{
+  syscall(33, 0, 0, 0);
+}
+
+int8_t fsync_syscall(int32_t fd)
+{
+  int8_t ret;
+  syscall(34, (uint32_t)fd, (uint32_t)&ret, 0);
+  return ret;
+}
+
+int8_t copy_syscall(struct FAT32DriverRequest src_request, struct FAT32DriverRequest dest_request)
+{
+  int8_t ret;
+  syscall(35, (uint32_t)&src_request, (uint32_t)&ret, (uint32_t)&dest_request);
+  return ret;
+}
+
+int8_t move_syscall(struct FAT32DriverRequest src_request, struct FAT32DriverRequest dest_request)
+{
+  int8_t ret;
+  syscall(36, (uint32_t)&src_request, (uint32_t)&ret, (uint32_t)&dest_request);
+  return ret;
+}
+
 void command(char *current_dir)
 {
   puts("UsusBuntu@OS-IF2230:", 21, 0xA);
@@ -157,122 +252,107 @@ int32_t is_include(char *str, char target)
   return 0;
 }
 
-void cd(char *argument)
+int strlen_before_char(char *str, char cmp)
+{
+  int i = 0;
+  while (str[i] != cmp && str[i] != '\0')
+  {
+    i++;
+  }
+  return i;
+}
+
+// Apply path onto current directory text, path must already be resolved
+void update_current_dir(char *path)
 {
-  if (memcmp("..", argument, 2) == 0 && strlen(argument) == 2)
+  if (path[0] == '/')
+  {
+    memset(current_dir, 0, sizeof(current_dir));
+    current_dir[0] = '/';
+    currentdirlen = 1;
+  }
+
+  uint32_t idx = 0;
+  while (path[idx] != '\0')
   {
-    request.parent_cluster_number = cwd_cluster_number;
-    if (cwd_cluster_number != ROOT_CLUSTER_NUMBER)
+    uint32_t length = strlen_before_char(path + idx, '/');
+    if (length == 2 && path[idx] == '.' && path[idx + 1] == '.')
     {
-      move_parent_dir(request, &retcode);
-      cwd_cluster_number = retcode;
-      currentdirlen -= 2;
-      while (current_dir[currentdirlen] != '/')
+      if (currentdirlen > 1)
       {
+        currentdirlen--;
         current_dir[currentdirlen] = '\0';
         currentdirlen--;
+        while (current_dir[currentdirlen] != '/')
+        {
+          current_dir[currentdirlen] = '\0';
+          currentdirlen--;
+        }
+        currentdirlen++;
       }
-      current_dir[currentdirlen] = '/';
-      currentdirlen++;
-    }
-  }
-  else
-  {
-    request.buffer_size = CLUSTER_SIZE;
-    request.buf = buf;
-    memcpy(request.name, argument, strlen(argument));
-    int idx = strlen(argument);
-    while (idx <= 7)
-    {
-      request.name[idx] = '\0';
-      idx++;
     }
-    memcpy(request.ext, "dir", 3);
-    request.parent_cluster_number = cwd_cluster_number;
-    read_dir_syscall(request, &retcode);
-    if (retcode == 0)
+    else if (length > 0 && !(length == 1 && path[idx] == '.'))
     {
-      move_child_dir(request, &retcode);
-      cwd_cluster_number = retcode;
-      int32_t idx = 0;
-      while (idx < strlen(request.name) && idx < 8)
+      uint32_t name_length = strlen_before_char(path + idx, '.');
+      if (name_length > length)
       {
-        current_dir[currentdirlen] = request.name[idx];
+        name_length = length;
+      }
+      if (currentdirlen + name_length + 1 < sizeof(current_dir))
+      {
+        memcpy(current_dir + currentdirlen, path + idx, name_length);
+        currentdirlen += name_length;
+        current_dir[currentdirlen] = '/';
         currentdirlen++;
-        idx++;
       }
-      current_dir[currentdirlen] = '/';
-      currentdirlen++;
     }
-    else if (retcode == 2)
+
+    idx += length;
+    if (path[idx] == '/')
     {
-      puts("Folder not found.\n", 18, 0xF);
+      idx++;
     }
   }
 }
 
-void reader_with_clust(uint32_t dir_cluster_number, char *name, char *ext)
+void cd(char *argument)
 {
-  // idk, for safety i guess
-  uint32_t len_name = strlen(name);
-  while (len_name < 8)
-  {
-    name[len_name] = '\0';
-    len_name++;
-  }
-  uint32_t len_ext = strlen(ext);
-  while (len_ext < 3)
+  // Whole path is resolved by kernel in one call
+  struct FAT32ResolvedPath resolved;
+  if (resolve_path_syscall(argument, cwd_cluster_number, &resolved) != 0 || !resolved.is_directory)
   {
-    ext[len_ext] = '\0';
-    len_ext++;
+    puts("Folder not found.\n", 18, 0xF);
+    return;
   }
-  request.buffer_size = CLUSTER_SIZE;
-  request.parent_cluster_number = dir_cluster_number;
-  memcpy(request.name, name, 8);
-  memcpy(request.ext, ext, 3);
-  read_syscall(request, &retcode);
+  cwd_cluster_number = resolved.cluster_number;
+  update_current_dir(argument);
 }
 
-void writer_with_clust(uint32_t dir_cluster_number, char *name, char *ext, char *buffer)
+// Fill 8-byte name and 3-byte extension of request, shorter input is padded with null
+void set_request_name(struct FAT32DriverRequest *target, char *name, char *ext)
 {
-  // idk, for safety i guess
   uint32_t len_name = strlen(name);
-  while (len_name < 8)
-  {
-    name[len_name] = '\0';
-    len_name++;
-  }
   uint32_t len_ext = strlen(ext);
-  while (len_ext < 3)
-  {
-    ext[len_ext] = '\0';
-    len_ext++;
-  }
-  uint32_t len_buffer = strlen(buffer);
-  while (len_buffer < 512)
-  {
-    buffer[len_buffer] = '\0';
-    len_buffer++;
-  }
-
-  // write file
-  request.buffer_size = CLUSTER_SIZE;
-  request.parent_cluster_number = dir_cluster_number;
-
-  memcpy(request.name, name, 8);
-  memcpy(request.ext, ext, 3);
-  memcpy(request.buf, buffer, 512);
-  write_syscall(request, &retcode);
+  memset(target->name, 0, 8);
+  memset(target->ext, 0, 3);
+  memcpy(target->name, name, len_name < 8 ? len_name : 8);
+  memcpy(target->ext, ext, len_ext < 3 ? len_ext : 3);
 }
 
-int strlen_before_char(char *str, char cmp)
+// Kernel copy the whole file in one syscall, destination is allocated at once and filled cluster by cluster
+void copy_with_clust(uint32_t src_cluster_number, char *src_name, char *src_ext, uint32_t dst_cluster_number, char *dst_name, char *dst_ext)
 {
-  int i = 0;
-  while (str[i] != cmp && str[i] != '\0')
-  {
-    i++;
-  }
-  return i;
+  struct FAT32DriverRequest src = {
+      .parent_cluster_number = src_cluster_number,
+  };
+  struct FAT32DriverRequest dst = {
+      .parent_cluster_number = dst_cluster_number,
+  };
+  set_request_name(&src, src_name, src_ext);
+  set_request_name(&dst, dst_name, dst_ext);
+
+  // Content never pass through user space, kernel copy it cluster to cluster
+  retcode = copy_syscall(src, dst);
 }
 
 void cp(char *argument)
@@ -322,19 +402,15 @@ void cp(char *argument)
   // puts(dest, strlen(dest), 0xF);
   // puts("\n", 1, 0xF);
 
-  // read source file
-  reader_with_clust(cwd_cluster_number, source_name, source_ext);
-
-  // copy the source content
-  char source_content[2000];
-  memcpy(source_content, request.buf, strlen(request.buf));
-  uint32_t temp = strlen(request.buf);
-
-  while (temp < 2000)
-  {
-    source_content[temp] = '\0';
-    temp++;
-  }
+  // check source file, content is copied by the kernel later
+  struct FAT32DriverRequest source_request = {
+      .buf = &cl,
+      .parent_cluster_number = cwd_cluster_number,
+      .buffer_size = CLUSTER_SIZE,
+  };
+  struct FAT32FileRange source_range = {0};
+  set_request_name(&source_request, source_name, source_ext);
+  retcode = pread_syscall(source_request, &source_range);
 
   // Source file found, check destination, arguments holds the path
   if (retcode == 0)
@@ -373,7 +449,7 @@ void cp(char *argument)
       // puts(target_name, 8, 0xF);
       // puts("\n", 1, 0xF);
 
-      writer_with_clust(cwd_cluster_number, target_name, target_ext, source_content);
+      copy_with_clust(cwd_cluster_number, source_name, source_ext, cwd_cluster_number, target_name, target_ext);
 
       if (retcode != 0)
       {
@@ -383,57 +459,20 @@ void cp(char *argument)
 
     else if (!is_include(dest, '.'))
     {
-      uint32_t cd_count = 0;
-      while (true)
-      {
-        cd_count++;
-        if (is_include(dest, '/'))
-        {
-          char res[strlen(dest)];
-          split_by_first(dest, '/', res);
-          cd(res);
-
-          if (retcode == 2)
-          {
-            cd_count--;
-            break;
-          }
-        }
-        else
-        {
-          cd(dest);
-          if (retcode == 2)
-          {
-            cd_count--;
-          }
-          break;
-        }
-      }
-
-      if (retcode == 2)
+      struct FAT32ResolvedPath resolved;
+      if (resolve_path_syscall(dest, cwd_cluster_number, &resolved) != 0 || !resolved.is_directory)
       {
         puts("the path is invalid\n", 21, 0x4);
-
-        for (uint32_t i = 0; i < cd_count; i++)
-        {
-          cd("..");
-        }
-
         return;
       }
 
       // implement copying file
-      writer_with_clust(cwd_cluster_number, source_name, source_ext, source_content);
+      copy_with_clust(cwd_cluster_number, source_name, source_ext, resolved.cluster_number, source_name, source_ext);
 
       if (retcode != 0)
       {
         puts("failed to copy \n", 17, 0x4);
       }
-
-      for (uint32_t i = 0; i < cd_count; i++)
-      {
-        cd("..");
-      }
     }
     else
     {
@@ -503,20 +542,39 @@ void cat(char *argument)
   memcpy(request.name, filename, name_len);
   memcpy(request.ext, argument, strlen(argument));
   request.parent_cluster_number = cwd_cluster_number;
-  read_syscall(request, &retcode);
+
+  // File is paged through fixed size buffer, text end at first null character
+  char chunk[CLUSTER_SIZE + 1];
+  int32_t fd;
+  retcode = open_syscall(request, &fd);
+  struct FAT32FileRequest io = {.fd = fd, .buf = chunk, .count = CLUSTER_SIZE};
+  while (retcode == 0)
+  {
+    retcode = read_fd_syscall(&io);
+    if (retcode != 0)
+    {
+      break;
+    }
+    chunk[io.transferred] = '\0';
+    puts(chunk, strlen(chunk), 0xF);
+    if (io.transferred < CLUSTER_SIZE || strlen(chunk) < CLUSTER_SIZE)
+    {
+      break;
+    }
+  }
+  if (fd >= 0)
+  {
+    close_syscall(fd);
+  }
+
   if (retcode == 0)
   {
-    puts(request.buf, strlen(request.buf), 0xF);
     puts("\n", 1, 0xF);
   }
   else if (retcode == 1)
   {
     puts("Not a file\n", 11, 0x4);
   }
-  else if (retcode == 2)
-  {
-    puts("Not enough buffer\n", 18, 0x4);
-  }
   else if (retcode == -1)
   {
     puts("Unknown error -1\n", 17, 0x4);
@@ -685,35 +743,36 @@ void search2(char *argument){
 
 uint32_t search_cluster_resolve_path(uint32_t cluster_number, char *path)
 {
-  uint32_t initial_cluster = cluster_number;
-  char initial_dir[255];
-  memcpy(initial_dir, current_dir, strlen(current_dir));
-  initial_dir[strlen(current_dir)] = '\0';
-  uint8_t initial_curdirlen = currentdirlen;
-  char initial_path[255];
-  memcpy(initial_path, path, strlen(path));
-  initial_path[strlen(path)] = '\0';
-  while (true)
-  {
-    if (is_include(path, '/'))
-    {
-      char res[strlen(path)];
-      split_by_first(path, '/', res);
-      cd(res);
-    }
-    else
+  // Only directory part of the path is resolved, last component is left for the caller
+  int32_t last_slash = -1;
+  for (int32_t i = 0; path[i] != '\0'; i++)
+  {
+    if (path[i] == '/')
     {
-      cluster_number = cwd_cluster_number;
-      break;
+      last_slash = i;
     }
   }
-  memcpy(current_dir, initial_dir, strlen(initial_dir));
-  current_dir[strlen(initial_dir)] = '\0';
-  currentdirlen = initial_curdirlen;
-  memcpy(path, initial_path, strlen(initial_path));
-  path[strlen(initial_path)] = '\0';
-  cwd_cluster_number = initial_cluster;
-  return cluster_number;
+  if (last_slash < 0)
+  {
+    return cluster_number;
+  }
+
+  char directory[255];
+  int32_t length = last_slash == 0 ? 1 : last_slash;
+  if (length > 254)
+  {
+    length = 254;
+  }
+  memcpy(directory, path, length);
+  directory[length] = '\0';
+
+  struct FAT32ResolvedPath resolved;
+  if (resolve_path_syscall(directory, cluster_number, &resolved) != 0 || !resolved.is_directory)
+  {
+    puts("Folder not found.\n", 18, 0xF);
+    return cluster_number;
+  }
+  return resolved.cluster_number;
 }
 
 void get_last_name(char *path, char *name)
@@ -741,127 +800,65 @@ void get_last_name(char *path, char *name)
 
 void mv(char *argument)
 {
-  char source[12];
-  char last_name[12];
-  char dest_last_name[12];
-  uint32_t source_cluster_number;
-  uint32_t dest_cluster_number;
-  char source_buffer[256];
-  char dest_buffer[256];
-
-  struct FAT32DriverRequest src_req;
-
-  struct FAT32DriverRequest dst_req;
-
+  char source[256];
   split_by_first(argument, ' ', source);
-  if (strlen(source) < 256)
-  {
-    source[strlen(source)] = '\0';
-  }
-  else
-  {
-    source[255] = '\0';
-  }
 
-  if (strlen(argument) < 256)
-  {
-    argument[strlen(argument)] = '\0';
-  }
-  else
+  struct FAT32ResolvedPath source_path;
+  if (resolve_path_syscall(source, cwd_cluster_number, &source_path) != 0)
   {
-    argument[255] = '\0';
+    puts("Source not found.\n", 19, 0x4);
+    return;
   }
+  struct FAT32DriverRequest src_req = {
+      .parent_cluster_number = source_path.parent_cluster_number,
+  };
+  memcpy(src_req.name, source_path.name, 8);
+  memcpy(src_req.ext, source_path.ext, 3);
 
-  memcpy(source_buffer, source, strlen(source));
-  memcpy(dest_buffer, argument, strlen(argument));
-
-  source_cluster_number = search_cluster_resolve_path(cwd_cluster_number, source);
-  dest_cluster_number = search_cluster_resolve_path(cwd_cluster_number, argument);
-  get_last_name(source, last_name);
-  get_last_name(argument, dest_last_name);
-  char src_name[8];
-  if (is_include(last_name, '.'))
+  // Existing directory as destination keep the name, otherwise last component is the new name
+  struct FAT32ResolvedPath dest_path;
+  struct FAT32DriverRequest dst_req = {0};
+  int8_t resolved = resolve_path_syscall(argument, cwd_cluster_number, &dest_path);
+  if (resolved == 0 && dest_path.is_directory)
   {
-    char src_ext[3];
-    split_by_first(last_name, '.', src_name);
-    memcpy(src_ext, last_name, 3);
-    memcpy(src_req.ext, src_ext, 3);
+    dst_req.parent_cluster_number = dest_path.cluster_number;
+    memcpy(dst_req.name, source_path.name, 8);
+    memcpy(dst_req.ext, source_path.ext, 3);
   }
-  else
+  else if (resolved == 1)
   {
-    memcpy(src_req.ext, "dir", 3);
-    memcpy(src_name, last_name, 8);
-    read_dir_syscall(src_req, &retcode);
-    if (retcode != 0)
-    {
-      memcpy(src_req.ext, "\0\0\0", 3);
-    }
+    dst_req.parent_cluster_number = dest_path.parent_cluster_number;
+    memcpy(dst_req.name, dest_path.name, 8);
+    memcpy(dst_req.ext, source_path.is_directory ? "dir" : dest_path.ext, 3);
   }
-
-  // Check extension
-  char dst_name[8];
-  if (is_include(dest_last_name, '.'))
+  else if (resolved == 0)
   {
-    puts("Destination is a file\n", 22, 0xF);
-    puts("Please specify a directory\n", 28, 0xF);
+    puts("Destination already exists.\n", 29, 0x4);
     return;
   }
   else
   {
-    memcpy(dst_req.ext, "dir", 3);
-    memcpy(dst_name, dest_last_name, 8);
-    read_dir_syscall(dst_req, &retcode);
-    if (retcode == 1)
-    {
-      puts("Destination is not a directory\n", 31, 0xF);
-      return;
-    }
-    else if (retcode == -1)
-    {
-      puts("Unknown error\n", 14, 0xF);
-      return;
-    }
-  }
-  src_req.buffer_size = CLUSTER_SIZE;
-  dst_req.buffer_size = CLUSTER_SIZE;
-  src_req.buf = source_buffer;
-  dst_req.buf = dest_buffer;
-  src_req.parent_cluster_number = source_cluster_number;
-  src_req.parent_cluster_number = dest_cluster_number;
-  retcode = move_sys(&src_req, &dst_req);
-  if (retcode == 0)
-  {
-    puts("Success move '", 14, 0xF);
-    puts(src_name, 8, 0xF);
-    if (memcmp(src_req.ext, "dir", 3) != 0)
-    {
-      puts(".", 1, 0xF);
-      puts(src_req.ext, 3, 0xF);
-    }
-    puts("' to '", 7, 0xF);
-    puts(dst_name, 8, 0xF);
-    puts("'\n", 2, 0xF);
+    puts("the path is invalid\n", 21, 0x4);
+    return;
   }
 
-  else if (retcode == 1)
+  // Only the directory entry is relinked, content is not copied
+  retcode = move_syscall(src_req, dst_req);
+  if (retcode == 2)
   {
-    puts("Error: Source entry not found.\n", 31, 0xF);
-  }
-  else if (retcode == 2)
-  {
-    puts("Error: Failed to read destination directory.\n", 45, 0xF);
+    puts("Destination already exists.\n", 29, 0x4);
   }
   else if (retcode == 3)
   {
-    puts("Error: Destination directory is full.\n", 39, 0xF);
+    puts("Cannot move a folder into itself.\n", 35, 0x4);
   }
   else if (retcode == 4)
   {
-    puts("Error: Source and destination directories are the same.\n", 56, 0xF);
+    puts("File cannot use dir extension.\n", 32, 0x4);
   }
-  else
+  else if (retcode != 0)
   {
-    puts("Error: Unknown error occurred.\n", 32, 0xF);
+    puts("failed to move \n", 17, 0x4);
   }
 }
 
@@ -1007,37 +1004,31 @@ void echo(char *argument)
   remove_petik(argument);
   char text[256];
   split_by_first(argument, '>', text);
-  request.buffer_size = CLUSTER_SIZE;
-  text[256] = '\0';
 
-  request.parent_cluster_number = cwd_cluster_number;
-  char name[8];
-  split_by_first(argument, '.', name);
-
-  argument[3] = '\0';
-  if (strlen(argument) < 3)
+  // "text >> file" append into the file, "text > file" replace its content
+  bool is_append = argument[0] == '>';
+  if (is_append)
   {
-    argument[strlen(argument)] = '\0';
+    memmove(argument, argument + 1, strlen(argument));
   }
 
+  request.parent_cluster_number = cwd_cluster_number;
+  char name[9];
+  split_by_first(argument, '.', name);
   name[8] = '\0';
-  if (strlen(name) < 8)
-  {
-    name[strlen(name)] = '\0';
-  }
+  argument[3] = '\0';
 
-  if (strlen(text) < 256)
-  {
-    text[strlen(text)] = '\0';
-  }
-  text[256] = '\0';
+  memset(request.name, 0, 8);
+  memset(request.ext, 0, 3);
+  memcpy(request.name, name, strlen(name));
+  memcpy(request.ext, argument, strlen(argument));
 
-  memcpy(request.buf, text, 256);
-  argument[3] = '\0';
-  memcpy(request.ext, argument, 4);
-  memcpy(request.name, name, 8);
+  uint32_t text_len = strlen(text);
+  memcpy(request.buf, text, text_len);
+  request.buffer_size = text_len;
 
-  read_syscall(request, &retcode);
+  // Only cluster touched by the new text is written, the file is never deleted and rewritten
+  retcode = is_append ? append_syscall(request) : overwrite_syscall(request);
 
   if (retcode == 1)
   {
@@ -1045,33 +1036,23 @@ void echo(char *argument)
   }
   else if (retcode == 2)
   {
-    puts("Not enough buffer\n", 18, 0xF);
+    puts("Not enough space.\n", 18, 0xF);
   }
   else if (retcode == 3)
   {
     puts("Not found.\n", 11, 0xF);
   }
-  else if (retcode == -1)
+  else if (retcode != 0)
   {
-    puts("Unknown error read.\n", 15, 0xF);
+    puts("Unknown error write.\n", 21, 0xF);
   }
   else
   {
-    delete_syscall(request, &retcode);
-    write_syscall(request, &retcode);
-
-    if (retcode != 0)
-    {
-      puts("Unknown error write.\n", 15, 0xF);
-    }
-    else
-    {
-      puts("File '", 8, 0xF);
-      puts(request.name, 8, 0xF);
-      puts(".", 1, 0xF);
-      puts(request.ext, 3, 0xF);
-      puts("' updated.\n", 12, 0xF);
-    }
+    puts("File '", 8, 0xF);
+    puts(request.name, 8, 0xF);
+    puts(".", 1, 0xF);
+    puts(request.ext, 3, 0xF);
+    puts("' updated.\n", 12, 0xF);
   }
 }
 
@@ -1265,6 +1246,123 @@ void clock()
   puts("\n", 1, 0xF);
 }
 
+void print_counter(char *label, uint32_t value)
+{
+  char number[12];
+  int_to_str((int)value, number);
+  puts(label, strlen(label), 0xF);
+  puts(number, strlen(number), 0xF);
+  puts("\n", 1, 0xF);
+}
+
+void iosched()
+{
+  struct ATASchedulerStatistics statistics;
+  syscall(20, (uint32_t)&statistics, 0, 0);
+
+  print_counter("write queued    : ", statistics.write_queued);
+  print_counter("write merged    : ", statistics.write_merged);
+  print_counter("write replaced  : ", statistics.write_replaced);
+  print_counter("write reordered : ", statistics.write_reordered);
+  print_counter("read command    : ", statistics.command_read);
+  print_counter("write command   : ", statistics.command_write);
+  print_counter("block read      : ", statistics.block_read);
+  print_counter("block written   : ", statistics.block_written);
+}
+
+void cachestat()
+{
+  struct BufferCacheStatistics statistics;
+  syscall(21, (uint32_t)&statistics, 0, 0);
+
+  print_counter("cache hit        : ", statistics.hit);
+  print_counter("cache miss       : ", statistics.miss);
+  print_counter("cache eviction   : ", statistics.eviction);
+  print_counter("cache write back : ", statistics.write_back);
+  print_counter("prefetch         : ", statistics.prefetch);
+  print_counter("prefetch hit     : ", statistics.prefetch_hit);
+  print_counter("cache discard    : ", statistics.discard);
+}
+
+void append_str(char *line, char *str)
+{
+  memcpy(line + strlen(line), str, strlen(str) + 1);
+}
+
+void append_number(char *line, uint32_t value)
+{
+  char number[12];
+  int_to_str((int)value, number);
+  append_str(line, number);
+}
+
+void append_pair(char *line, char *label, uint32_t first, uint32_t second)
+{
+  append_str(line, label);
+  append_number(line, first);
+  append_str(line, "/");
+  append_number(line, second);
+}
+
+void print_histogram(char *label, uint32_t *histogram)
+{
+  char line[256] = {0};
+  append_str(line, label);
+  for (uint8_t i = 0; i < IOSTAT_HISTOGRAM_BUCKET; i++)
+  {
+    if (histogram[i] > 0)
+    {
+      append_str(line, " 2^");
+      append_number(line, i);
+      append_str(line, ":");
+      append_number(line, histogram[i]);
+    }
+  }
+  append_str(line, "\n");
+  puts(line, strlen(line), 0xF);
+}
+
+void iostat()
+{
+  struct ATASchedulerStatistics device;
+  struct BufferCacheStatistics cache;
+  struct IOStatistics statistics;
+  syscall(20, (uint32_t)&device, 0, 0);
+  syscall(21, (uint32_t)&cache, 0, 0);
+  syscall(22, (uint32_t)&statistics, 0, 0);
+
+  char line[256] = {0};
+  append_pair(line, "disk cmd r/w ", device.command_read, device.command_write);
+  append_pair(line, "  KiB r/w ", device.block_read / 2, device.block_written / 2);
+  append_str(line, "  merged ");
+  append_number(line, device.write_merged);
+  append_str(line, "  cache hit ");
+  append_number(line, cache.hit);
+  append_str(line, "\n");
+  puts(line, strlen(line), 0xF);
+
+  char *class_name[IOSTAT_CLASS_COUNT] = {"other", "fat  ", "dir  ", "data ", "jrnl "};
+  for (uint8_t i = 0; i < IOSTAT_CLASS_COUNT; i++)
+  {
+    struct IOStatClassStatistics *class_statistics = &statistics.class_statistics[i];
+    memset(line, 0, sizeof(line));
+    append_str(line, class_name[i]);
+    append_pair(line, " req r/w ", class_statistics->read_request, class_statistics->write_request);
+    append_pair(line, "  block r/w ", class_statistics->block_read, class_statistics->block_written);
+    append_str(line, "  hit ");
+    append_number(line, class_statistics->cache_hit);
+    append_str(line, "\n");
+    puts(line, strlen(line), 0xF);
+
+    // Histogram is copied out of packed struct, print_histogram() need aligned array
+    uint32_t histogram[IOSTAT_HISTOGRAM_BUCKET];
+    memcpy(histogram, class_statistics->read_latency, sizeof(histogram));
+    print_histogram("  read cycle ", histogram);
+    memcpy(histogram, class_statistics->write_latency, sizeof(histogram));
+    print_histogram("  write cycle", histogram);
+  }
+}
+
 int main(void)
 {
   buf[2000] = '\0';
@@ -1307,20 +1405,7 @@ int main(void)
     {
       char *argument = buf + 3;
       remove_newline(argument);
-      while (true)
-      {
-        if (is_include(argument, '/'))
-        {
-          char res[strlen(argument)];
-          split_by_first(argument, '/', res);
-          cd(res);
-        }
-        else
-        {
-          cd(argument);
-          break;
-        }
-      }
+      cd(argument);
 
       clear_buf();
       command(current_dir);
@@ -1543,7 +1628,7 @@ int main(void)
       puts("3.  print\n", 11, 0xF);
       puts("4.  mkdir [directory]\n", 23, 0xF);
       puts("5.  touch [file]\n", 18, 0xF);
-      puts("6.  echo [text] > [file]\n", 26, 0xF);
+      puts("6.  echo [text] >/>> [file]\n", 29, 0xF);
       puts("7.  cat [file]\n", 16, 0xF);
       puts("8.  rm [file]\n", 15, 0xF);
       puts("9.  find [file]\n", 17, 0xF);
@@ -1552,11 +1637,43 @@ int main(void)
       puts("12. help\n", 10, 0xF);
       puts("12. search1 [input string]\n", 27, 0xF);
       puts("12. search2 [input string]\n", 27, 0xF);
+      puts("13. iosched\n", 12, 0xF);
+      puts("14. cachestat\n", 14, 0xF);
+      puts("15. iostat\n", 11, 0xF);
+      puts("16. sync\n", 9, 0xF);
 
       clear_buf();
       command(current_dir);
       activate_keyboard();
     }
+    else if (!memcmp(buf, "iostat", 6))
+    {
+      iostat();
+      clear_buf();
+      command(current_dir);
+      activate_keyboard();
+    }
+    else if (!memcmp(buf, "iosched", 7))
+    {
+      iosched();
+      clear_buf();
+      command(current_dir);
+      activate_keyboard();
+    }
+    else if (!memcmp(buf, "cachestat", 9))
+    {
+      cachestat();
+      clear_buf();
+      command(current_dir);
+      activate_keyboard();
+    }
+    else if (!memcmp(buf, "sync", 4))
+    {
+      sync_syscall();
+      clear_buf();
+      command(current_dir);
+      activate_keyboard();
+    }
     else if (!memcmp(buf, "clock", 5))
     {
       clock();